@@ -1,10 +1,12 @@
 #include "Acceptor.h"
 #include "Logger.h"
 #include "InetAddress.h"
+#include "EventLoop.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 static int createNonblocking()
@@ -22,18 +24,30 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
     , acceptSocket_(createNonblocking()) // socket
     , acceptChannel_(loop, acceptSocket_.fd())
     , listenning_(false)
+    , acceptBatch_(kDefaultAcceptBatch)
+    , idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
     acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
+    acceptSocket_.setReusePort(reuseport);
     acceptSocket_.bindAddress(listenAddr);
     // 注册事件处理器
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
+    acceptChannel_.setDescription([](const void*) { return std::string("acceptor"); }, nullptr);
+    if (idleFd_ < 0)
+    {
+        LOG_ERROR("%s:%s:%d open /dev/null err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
 }
 
 Acceptor::~Acceptor()
 {
+    loop_->cancel(resumeTimer_);
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 
@@ -46,25 +60,107 @@ void Acceptor::listen()
 
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr; // 客户的ip地址和端口
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    // 连接风暴时一次事件接受多个连接，减少epoll_wait的次数；设上限防止饿死loop上的其他事件
+    for (int i = 0; i < acceptBatch_; ++i)
     {
-        if (newConnectionCallback_)
+        InetAddress peerAddr; // 客户的ip地址和端口
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
         {
-            newConnectionCallback_(connfd, peerAddr); // 回调由TcpServer设置
+            if (newConnectionBatchCallback_)
+            {
+                accepted_.emplace_back(connfd, peerAddr);
+            }
+            else if (newConnectionCallback_)
+            {
+                newConnectionCallback_(connfd, peerAddr); // 回调由TcpServer设置
+            }
+            else // 有新用户连接却没有回调
+            {
+                ::close(connfd);
+            }
+            continue;
         }
-        else // 有新用户连接却没有回调
+
+        int savedErrno = errno;
+        if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) // 已经接受完了
         {
-            ::close(connfd);
+            break;
         }
-    }
-    else
-	{
-        LOG_ERROR("%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE) // 连接数超过限制
+        if (savedErrno == EMFILE || savedErrno == ENFILE) // 连接数超过限制
         {
             LOG_ERROR("%s:%s:%d sockfd reached limit! \n", __FILE__, __FUNCTION__, __LINE__);
+            /**
+             * 不把连接取走的话，水平触发下监听socket一直可读，loop会空转；
+             * 释放预留的fd，接受这个连接后立即关闭，对端会收到FIN而不是一直等待
+            */
+            if (!discardConnection())
+            {
+                pauseAccepting();
+                break;
+            }
+            continue;
+        }
+        if (savedErrno == ECONNABORTED || savedErrno == EINTR || savedErrno == EPROTO)
+        {
+            continue; // 对端在accept之前就断开了，不算错误
+        }
+        LOG_ERROR("%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
+        break;
+    }
+
+    if (!accepted_.empty())
+    {
+        newConnectionBatchCallback_(accepted_);
+        accepted_.clear();
+    }
+}
+
+bool Acceptor::discardConnection()
+{
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+        int connfd = ::accept4(acceptSocket_.fd(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (connfd >= 0)
+        {
+            ::close(connfd);
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            // 多个loop共用fd表（kReusePortPerLoop），腾出的位置可能已经被别的线程占用
+            LOG_ERROR("%s:%s:%d discard accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
         }
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    if (idleFd_ < 0)
+    {
+        LOG_ERROR("%s:%s:%d reopen /dev/null err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+        return false;
+    }
+    return true;
+}
+
+void Acceptor::pauseAccepting()
+{
+    // 没有预留fd就取不走连接，水平触发下会一直空转，先停止监听可读，等fd释放后再恢复
+    LOG_ERROR("%s:%s:%d no spare fd, pause accepting for %d ms \n", __FILE__, __FUNCTION__, __LINE__, kResumeDelayMs);
+    acceptChannel_.disableReading();
+    resumeTimer_ = loop_->runAfter(kResumeDelayMs / 1000.0, std::bind(&Acceptor::resumeAccepting, this));
+}
+
+void Acceptor::resumeAccepting()
+{
+    resumeTimer_ = TimerId();
+    if (idleFd_ < 0)
+    {
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    if (idleFd_ < 0)
+    {
+        resumeTimer_ = loop_->runAfter(kResumeDelayMs / 1000.0, std::bind(&Acceptor::resumeAccepting, this));
+        return;
     }
+    LOG_INFO("%s:%s:%d resume accepting \n", __FILE__, __FUNCTION__, __LINE__);
+    acceptChannel_.enableReading();
 }
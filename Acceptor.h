@@ -4,16 +4,24 @@
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "InetAddress.h"
+#include "TimerId.h"
 
 #include <functional>
+#include <utility>
+#include <vector>
 
 class EventLoop;
-class InetAddress;
 
 class Acceptor : noncopyable
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)>;
+    using AcceptedList = std::vector<std::pair<int, InetAddress>>; // 一次可读事件接受的连接
+    using NewConnectionBatchCallback = std::function<void(const AcceptedList&)>;
+
+    static const int kDefaultAcceptBatch = 16;
+    static const int kResumeDelayMs = 100; // 预留fd补不回来时暂停接受连接，隔这么久再试
 
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
     ~Acceptor();
@@ -23,16 +31,34 @@ public:
     {
         newConnectionCallback_ = cb;
     }
+    // 设置后一次可读事件接受的所有连接通过它一起交出，代替逐个调用NewConnectionCallback
+    void setNewConnectionBatchCallback(const NewConnectionBatchCallback &cb)
+    {
+        newConnectionBatchCallback_ = cb;
+    }
+    // 每次可读事件最多连续accept的连接数
+    void setAcceptBatch(int batch) { acceptBatch_ = batch > 0 ? batch : 1; }
+
+    // SO_REUSEPORT组里优先接收在cpu上处理的连接，loop绑核时设置为所绑的cpu
+    void setIncomingCpu(int cpu) { acceptSocket_.setIncomingCpu(cpu); }
 
     bool listenning() const { return listenning_; }
     void listen();
 
 private:
     void handleRead(); // mainLoop监听到可读事件后的事件处理，用于处理新用户连接，类似accept()
+    bool discardConnection(); // fd耗尽时用预留fd接受并关闭一个连接，预留fd补不回来时返回false
+    void pauseAccepting();
+    void resumeAccepting();
     
     EventLoop *loop_; // Acceptor使用baseLoop即mainLoop，acceptSocket由mainLoop循环监听
     Socket acceptSocket_;
     Channel acceptChannel_; // 连接后由poller监听事件
     NewConnectionCallback newConnectionCallback_; // 把connd包装为channel发给subLoop
+    NewConnectionBatchCallback newConnectionBatchCallback_;
     bool listenning_;
+    int acceptBatch_;
+    int idleFd_; // 预留的fd，文件描述符耗尽时用它腾出位置接受并关闭新连接
+    TimerId resumeTimer_; // 暂停期间重新开始接受连接的定时器
+    AcceptedList accepted_; // 复用的批量缓冲
 };
@@ -0,0 +1,217 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include "CurrentThread.h"
+
+#include <stdio.h>
+#include <chrono>
+
+const int AsyncLogging::kFlushTimeoutSeconds;
+
+AsyncLogging::AsyncLogging(const std::string &basename,
+                           off_t rollSize,
+                           int flushInterval,
+                           int maxBuffers)
+    : flushInterval_(flushInterval)
+    , maxBuffers_(maxBuffers < 4 ? 4 : maxBuffers) // 前端两块，后台两块
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , running_(false)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging")
+    , currentBuffer_(new LogBuffer)
+    , numBuffers_(1)
+    , threadReady_(false)
+    , attached_(false)
+    , flushRequested_(0)
+    , flushDone_(0)
+    , dropped_(0)
+    , totalDropped_(0)
+{
+    buffers_.reserve(maxBuffers_);
+    freeBuffers_.reserve(maxBuffers_);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!threadReady_)
+    {
+        startedCond_.wait(lock);
+    }
+}
+
+void AsyncLogging::stop()
+{
+    if (attached_)
+    {
+        // 返回时其他线程已经不会再调用append/flush，之后可以安全地停线程、析构
+        Logger::instance().resetOutput();
+        attached_ = false;
+    }
+    running_ = false;
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::attachToLogger()
+{
+    using namespace std::placeholders;
+    Logger::instance().setOutput(std::bind(&AsyncLogging::append, this, _1, _2));
+    Logger::instance().setFlush(std::bind(&AsyncLogging::flush, this));
+    attached_ = true;
+}
+
+void AsyncLogging::flush()
+{
+    // 后台线程自己不会等自己
+    if (!running_ || CurrentThread::tid() == thread_.tid())
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    const int64_t request = ++flushRequested_;
+    cond_.notify_one();
+    flushedCond_.wait_for(lock, std::chrono::seconds(kFlushTimeoutSeconds),
+        [this, request]() { return flushDone_ >= request || !running_; });
+}
+
+AsyncLogging::BufferPtr AsyncLogging::takeFreeBuffer()
+{
+    BufferPtr buffer;
+    if (!freeBuffers_.empty())
+    {
+        buffer = std::move(freeBuffers_.back());
+        freeBuffers_.pop_back();
+    }
+    else if (numBuffers_ < maxBuffers_)
+    {
+        buffer.reset(new LogBuffer);
+        ++numBuffers_;
+    }
+    return buffer;
+}
+
+void AsyncLogging::append(const char *logline, int len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (currentBuffer_ && currentBuffer_->avail() > len)
+    {
+        currentBuffer_->append(logline, len);
+        return;
+    }
+
+    // 当前缓冲写满，交给后台线程，换一块空闲缓冲
+    if (currentBuffer_)
+    {
+        buffers_.push_back(std::move(currentBuffer_));
+        cond_.notify_one();
+    }
+    currentBuffer_ = takeFreeBuffer();
+    if (currentBuffer_ && len < LogBuffer::kSize)
+    {
+        currentBuffer_->append(logline, len);
+    }
+    else
+    {
+        // 内存已达上限，后台线程跟不上，丢弃而不是阻塞调用线程
+        ++dropped_;
+        ++totalDropped_;
+    }
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(maxBuffers_);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        threadReady_ = true;
+        startedCond_.notify_one();
+    }
+
+    while (running_)
+    {
+        int64_t dropped = 0;
+        int64_t flushRequest = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty() && flushRequested_ == flushDone_)
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            flushRequest = flushRequested_; // 这一轮写完，之前所有的flush请求都完成了
+            // 未写满的当前缓冲也一起写出去，保证日志最多延迟flushInterval_秒
+            if (currentBuffer_ && currentBuffer_->length() > 0)
+            {
+                buffers_.push_back(std::move(currentBuffer_));
+                currentBuffer_ = takeFreeBuffer();
+            }
+            buffersToWrite.swap(buffers_);
+            dropped = dropped_;
+            dropped_ = 0;
+        }
+
+        if (dropped > 0)
+        {
+            char buf[256];
+            int n = snprintf(buf, sizeof buf, "[ERROR]%s : dropped %ld log messages, %lu buffers pending\n",
+                             Timestamp::now().toString().c_str(), dropped, buffersToWrite.size());
+            ::fputs(buf, stderr);
+            output.append(buf, n);
+        }
+
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+        output.flush();
+
+        // 写完的缓冲回收
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (flushRequest > flushDone_)
+            {
+                flushDone_ = flushRequest;
+                flushedCond_.notify_all();
+            }
+            for (BufferPtr &buffer : buffersToWrite)
+            {
+                buffer->reset();
+                if (!currentBuffer_)
+                {
+                    currentBuffer_ = std::move(buffer);
+                }
+                else
+                {
+                    freeBuffers_.push_back(std::move(buffer));
+                }
+            }
+        }
+        buffersToWrite.clear();
+    }
+
+    // 退出前把剩下的日志写完
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (currentBuffer_ && currentBuffer_->length() > 0)
+    {
+        buffers_.push_back(std::move(currentBuffer_));
+    }
+    for (const BufferPtr &buffer : buffers_)
+    {
+        output.append(buffer->data(), buffer->length());
+    }
+    output.flush();
+}
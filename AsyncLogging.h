@@ -0,0 +1,107 @@
+// 异步日志后端：前端线程只把日志拷贝进内存缓冲，后台线程负责写文件
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <sys/types.h>
+
+/**
+ * 双缓冲：前端写currentBuffer_，写满后放入buffers_，换上备用缓冲继续写；
+ * 后台线程定期或者被唤醒后，把buffers_整体交换出来写文件，写完的缓冲回收复用
+ * 缓冲总数有上限，后台线程来不及写时直接丢弃日志并计数，绝不阻塞I/O线程
+ *
+ * 用法：
+ *   AsyncLogging log("/tmp/server", 500 * 1024 * 1024);
+ *   log.start();
+ *   log.attachToLogger(); // 同时接管Logger的输出和FATAL退出前的刷新
+*/
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string &basename,
+                 off_t rollSize,
+                 int flushInterval = 3,
+                 int maxBuffers = 16);
+    ~AsyncLogging();
+
+    // 前端接口，线程安全
+    void append(const char *logline, int len);
+
+    void start();
+    void stop();
+
+    // 阻塞到调用之前append的日志都写进文件，LOG_FATAL退出进程之前调用；最多等kFlushTimeoutSeconds秒
+    void flush();
+    // 把Logger的输出换成append、刷新换成flush；stop时恢复Logger默认的stdout输出
+    void attachToLogger();
+
+    // 后台线程来不及写而丢弃的日志条数
+    int64_t droppedMessages() const { return totalDropped_; }
+
+private:
+    static const int kFlushTimeoutSeconds = 5;
+
+    // 固定大小的日志缓冲
+    class LogBuffer : noncopyable
+    {
+    public:
+        static const int kSize = 4 * 1024 * 1024;
+
+        LogBuffer() : cur_(data_) {}
+
+        int avail() const { return static_cast<int>(end() - cur_); }
+        int length() const { return static_cast<int>(cur_ - data_); }
+        const char *data() const { return data_; }
+
+        void append(const char *buf, int len)
+        {
+            ::memcpy(cur_, buf, len);
+            cur_ += len;
+        }
+        void reset() { cur_ = data_; }
+    private:
+        const char *end() const { return data_ + sizeof data_; }
+
+        char data_[kSize];
+        char *cur_;
+    };
+
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    void threadFunc();
+    // 取一块空闲缓冲，已达上限返回空，调用者持有mutex_
+    BufferPtr takeFreeBuffer();
+
+    const int flushInterval_; // 后台线程最长多少秒写一次文件
+    const int maxBuffers_; // 缓冲总数上限，控制内存
+    const std::string basename_;
+    const off_t rollSize_;
+
+    std::atomic_bool running_;
+    Thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::condition_variable startedCond_; // start等待后台线程就绪
+    std::condition_variable flushedCond_; // flush等待后台线程写完
+
+    BufferPtr currentBuffer_;
+    BufferVector buffers_; // 写满等待后台线程写文件的缓冲
+    BufferVector freeBuffers_; // 写完回收的缓冲
+    int numBuffers_; // 已经分配的缓冲总数
+    bool threadReady_;
+    bool attached_;
+    int64_t flushRequested_; // flush请求的序号，受mutex_保护
+    int64_t flushDone_; // 后台线程已经写完的flush序号，受mutex_保护
+
+    int64_t dropped_; // 上次写文件后丢弃的条数，受mutex_保护
+    std::atomic<int64_t> totalDropped_;
+};
@@ -4,9 +4,19 @@
 #include <sys/uio.h>
 #include <unistd.h>
 
-ssize_t Buffer::readFd(int fd, int *saveErrno)
+__thread int64_t t_bufferGrowths = 0;
+
+// 每个线程一块临时缓冲，不需要每次在栈上分配并清零64K
+static __thread char t_extrabuf[65536];
+
+ssize_t Buffer::readFd(int fd, int *saveErrno, size_t sizeHint)
 {
-    char extrabuf[65536] = {0}; // 栈上的内存空间，作用域内释放
+    char *extrabuf = t_extrabuf;
+    const size_t extraSize = sizeof t_extrabuf;
+    if (writableBytes() < sizeHint)
+    {
+        ensureWriteableBytes(sizeHint);
+    }
 
     struct iovec vec[2];
     
@@ -15,9 +25,9 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
     vec[0].iov_len = writable;
 
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_len = extraSize;
 
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    const int iovcnt = (writable < extraSize) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
     if (n < 0)
     {
@@ -45,3 +55,31 @@ ssize_t Buffer::writeFd(int fd, int *saveErrno)
     }
     return n;
 }
+
+ssize_t Buffer::writeFd(int fd, const struct iovec *extra, int extraCount, int *saveErrno)
+{
+    if (extraCount == 0)
+    {
+        return writeFd(fd, saveErrno);
+    }
+
+    struct iovec vec[1 + kMaxExtraIovecs];
+    int iovcnt = 0;
+    if (readableBytes() > 0)
+    {
+        vec[iovcnt].iov_base = const_cast<char*>(peek());
+        vec[iovcnt].iov_len = readableBytes();
+        ++iovcnt;
+    }
+    for (int i = 0; i < extraCount && i < kMaxExtraIovecs; ++i)
+    {
+        vec[iovcnt++] = extra[i];
+    }
+
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
@@ -4,6 +4,13 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <sys/types.h>
+#include <stdint.h>
+
+struct iovec;
+
+// 当前线程里Buffer扩容（重新分配内存）的次数，EventLoop据此统计本loop的扩容
+extern __thread int64_t t_bufferGrowths;
 
 /**
  * | prependable bytes | readable bytes | writable bytes |
@@ -16,6 +23,7 @@ class Buffer
 public:
     static const size_t kCheapPrepend = 8; // prependable（前置）的大小
     static const size_t kInitialSize = 1024;
+    static const int kMaxExtraIovecs = 64; // writeFd一次最多附带的片段数
 
     explicit Buffer(size_t initialSize = kInitialSize)
         : buffer_(kCheapPrepend + initialSize)
@@ -94,15 +102,39 @@ public:
         writerIndex_ += len;
     }
 
+    // 释放多余的内存，只保留可读数据和reserve字节的可写空间，空闲连接用它归还突发流量撑大的缓冲
+    void shrink(size_t reserve)
+    {
+        const size_t readable = readableBytes();
+        std::vector<char> buf(kCheapPrepend + readable + reserve);
+        if (readable > 0) // 空闲连接多半没有可读数据，reserve为0时buf里只有prepend
+        {
+            std::copy(peek(), peek() + readable, buf.begin() + kCheapPrepend);
+        }
+        writerIndex_ = kCheapPrepend + readable;
+        readerIndex_ = kCheapPrepend;
+        buffer_.swap(buf);
+    }
+
+    // 底层vector占用的内存
+    size_t internalCapacity() const
+    {
+        return buffer_.capacity();
+    }
+
     char *beginWrite()
     {
         return begin() + writerIndex_;
     }
 
     // 从fd上读取数据（读入缓冲）
-    ssize_t readFd(int fd, int *saveErrno);
+    // sizeHint是预计的读取量，先预留这么多空间让数据直接读进缓冲，超出的部分经由线程的临时缓冲追加
+    ssize_t readFd(int fd, int *saveErrno, size_t sizeHint = 0);
     // 从fd上写数据
     ssize_t writeFd(int fd, int *saveErrno);
+    // 可读数据后面再接上extra里的片段，一次writev写出，不会把片段拷贝进缓冲
+    // 返回写出的总字节数，调用者自己按顺序从本缓冲和片段中扣除
+    ssize_t writeFd(int fd, const struct iovec *extra, int extraCount, int *saveErrno);
 
 private:
     char *begin()
@@ -120,6 +152,7 @@ private:
     {
         if (writableBytes() + prependableBytes() < len + kCheapPrepend)
         {
+            ++t_bufferGrowths;
             buffer_.resize(writerIndex_ + len);
         }
         else // 挪动空间，将readerIndex_前移
@@ -135,3 +168,54 @@ private:
     size_t readerIndex_; // 读完的首址
     size_t writerIndex_; // 写入的尾址
 };
+
+/**
+ * 自适应的单次读取大小：上一次读满了就加倍，连续两次读不到一半就减半
+ * 大流量的连接很快增长到上限，一次readv读更多；小包RPC的连接保持在下限，缓冲不会被撑大
+*/
+class ReadSizer
+{
+public:
+    static const size_t kDefaultMin = 512;
+    static const size_t kDefaultMax = 64 * 1024;
+
+    explicit ReadSizer(size_t minSize = kDefaultMin, size_t maxSize = kDefaultMax)
+        : minSize_(minSize)
+        , maxSize_(maxSize < minSize ? minSize : maxSize)
+        , next_(minSize_ * 4 < maxSize_ ? minSize_ * 4 : maxSize_)
+        , decreaseNow_(false)
+    {}
+
+    size_t next() const { return next_; }
+
+    void record(size_t bytesRead)
+    {
+        if (bytesRead >= next_)
+        {
+            next_ = std::min(next_ * 2, maxSize_);
+            decreaseNow_ = false;
+        }
+        else if (bytesRead <= next_ / 2)
+        {
+            if (decreaseNow_)
+            {
+                next_ = std::max(next_ / 2, minSize_);
+                decreaseNow_ = false;
+            }
+            else
+            {
+                decreaseNow_ = true;
+            }
+        }
+        else
+        {
+            decreaseNow_ = false;
+        }
+    }
+
+private:
+    size_t minSize_;
+    size_t maxSize_;
+    size_t next_;
+    bool decreaseNow_;
+};
@@ -0,0 +1,83 @@
+#include "BufferPool.h"
+
+#include <stdlib.h>
+
+BufferPool::BufferPool(size_t blockSize, size_t maxFreeBlocks)
+    : blockSize_(blockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : blockSize)
+    , maxFreeBlocks_(maxFreeBlocks)
+    , freeList_(nullptr)
+    , lowFree_(0)
+    , freeCount_(0)
+    , inUse_(0)
+    , highWater_(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    while (freeList_)
+    {
+        FreeBlock *next = freeList_->next;
+        ::free(freeList_);
+        freeList_ = next;
+    }
+}
+
+void *BufferPool::allocate()
+{
+    void *block;
+    size_t freeCount = freeCount_.load(std::memory_order_relaxed);
+    if (freeList_)
+    {
+        block = freeList_;
+        freeList_ = freeList_->next;
+        --freeCount;
+        freeCount_.store(freeCount, std::memory_order_relaxed);
+        if (freeCount < lowFree_)
+        {
+            lowFree_ = freeCount;
+        }
+    }
+    else
+    {
+        block = ::malloc(blockSize_);
+    }
+
+    size_t inUse = inUse_.load(std::memory_order_relaxed) + 1;
+    inUse_.store(inUse, std::memory_order_relaxed);
+    if (inUse > highWater_.load(std::memory_order_relaxed))
+    {
+        highWater_.store(inUse, std::memory_order_relaxed);
+    }
+    return block;
+}
+
+void BufferPool::deallocate(void *block)
+{
+    inUse_.store(inUse_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    size_t freeCount = freeCount_.load(std::memory_order_relaxed);
+    if (freeCount >= maxFreeBlocks_)
+    {
+        ::free(block);
+        return;
+    }
+    FreeBlock *node = static_cast<FreeBlock*>(block);
+    node->next = freeList_;
+    freeList_ = node;
+    freeCount_.store(freeCount + 1, std::memory_order_relaxed);
+}
+
+void BufferPool::trim()
+{
+    size_t freeCount = freeCount_.load(std::memory_order_relaxed);
+    size_t release = lowFree_ < freeCount ? lowFree_ : freeCount;
+    for (size_t i = 0; i < release; ++i)
+    {
+        FreeBlock *next = freeList_->next;
+        ::free(freeList_);
+        freeList_ = next;
+    }
+    freeCount -= release;
+    freeCount_.store(freeCount, std::memory_order_relaxed);
+    lowFree_ = freeCount;
+}
@@ -0,0 +1,50 @@
+// 每个EventLoop一个的缓冲块池，连接的ChainBuffer按需借块，用完归还
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * 固定大小的内存块池，空闲块串成单链表（链表指针就存在块的开头）
+ * 只在所属loop线程分配和归还，不加锁；统计数据用原子变量，其他线程可以读取
+ * 定期trim：把上一个周期里一直没用上的空闲块还给系统，突发流量过后内存会回落
+*/
+class BufferPool : noncopyable
+{
+public:
+    explicit BufferPool(size_t blockSize, size_t maxFreeBlocks = 4096);
+    ~BufferPool();
+
+    void *allocate();
+    void deallocate(void *block);
+
+    // 释放上次trim以来一直空闲的块，由loop定期调用
+    void trim();
+
+    size_t blockSize() const { return blockSize_; }
+    // 池里空闲的块数
+    size_t freeBlocks() const { return freeCount_.load(std::memory_order_relaxed); }
+    // 借出未归还的块数
+    size_t inUseBlocks() const { return inUse_.load(std::memory_order_relaxed); }
+    // 借出块数的历史最大值
+    size_t highWaterBlocks() const { return highWater_.load(std::memory_order_relaxed); }
+    // 池占用的总内存（空闲+借出）
+    size_t totalBytes() const { return (freeBlocks() + inUseBlocks()) * blockSize_; }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    const size_t blockSize_;
+    const size_t maxFreeBlocks_; // 空闲块上限，超过的直接还给系统
+    FreeBlock *freeList_;
+    size_t lowFree_; // 本周期内空闲块数的最小值，这么多块整个周期都没被用到
+
+    std::atomic<size_t> freeCount_;
+    std::atomic<size_t> inUse_;
+    std::atomic<size_t> highWater_;
+};
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <functional>
+#include <string>
 
 class Buffer;
 class TcpConnection;
@@ -21,3 +22,9 @@ using MessageCallback = std::function<void(const TcpConnectionPtr &,
 										Timestamp)>;
 
 using HighWaterMarkCallback = std::function<void (const TcpConnectionPtr&, size_t)>;
+
+// 定时器到期的回调
+using TimerCallback = std::function<void()>;
+
+// 慢回调报告里描述回调属于谁（例如TcpConnection的名字），只在需要报告时调用
+using DescribeCallback = std::string (*)(const void *owner);
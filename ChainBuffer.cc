@@ -0,0 +1,276 @@
+#include "ChainBuffer.h"
+#include "BufferPool.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+
+// readFd一次最多挂的新块数，加上尾块剩余空间，一次最多读64K左右
+static const int kReadBlocks = 4;
+
+ChainBuffer::ChainBuffer(BufferPool *pool)
+    : pool_(pool)
+    , head_(nullptr)
+    , tail_(nullptr)
+    , readable_(0)
+    , numBlocks_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    while (head_)
+    {
+        Block *next = head_->next;
+        freeBlock(head_);
+        head_ = next;
+    }
+}
+
+size_t ChainBuffer::writableBytes() const
+{
+    return tail_ ? tail_->writable() : 0;
+}
+
+size_t ChainBuffer::prependableBytes() const
+{
+    return head_ ? head_->readerIndex : 0;
+}
+
+size_t ChainBuffer::contiguousBytes() const
+{
+    return head_ ? head_->readable() : 0;
+}
+
+const char *ChainBuffer::peek() const
+{
+    return head_ ? head_->data + head_->readerIndex : nullptr;
+}
+
+size_t ChainBuffer::blockAllocSize()
+{
+    return sizeof(Block);
+}
+
+ChainBuffer::Block *ChainBuffer::allocBlock()
+{
+    Block *block = pool_ ? static_cast<Block*>(pool_->allocate()) : new Block;
+    block->next = nullptr;
+    block->readerIndex = block->writerIndex = kCheapPrepend;
+    ++numBlocks_;
+    return block;
+}
+
+void ChainBuffer::freeBlock(Block *block)
+{
+    --numBlocks_;
+    if (pool_)
+    {
+        pool_->deallocate(block);
+    }
+    else
+    {
+        delete block;
+    }
+}
+
+void ChainBuffer::pushBack(Block *block)
+{
+    if (tail_)
+    {
+        tail_->next = block;
+    }
+    else
+    {
+        head_ = block;
+    }
+    tail_ = block;
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    if (len >= readable_)
+    {
+        retrieveAll();
+        return;
+    }
+
+    readable_ -= len;
+    while (len > 0)
+    {
+        size_t n = std::min(len, head_->readable());
+        head_->readerIndex += n;
+        len -= n;
+        if (head_->readable() == 0) // 读完的块直接释放
+        {
+            Block *next = head_->next;
+            freeBlock(head_);
+            head_ = next;
+        }
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    while (head_)
+    {
+        Block *next = head_->next;
+        freeBlock(head_);
+        head_ = next;
+    }
+    tail_ = nullptr;
+    readable_ = 0;
+}
+
+std::string ChainBuffer::retrieveAsString(size_t len)
+{
+    len = std::min(len, readable_);
+    std::string result;
+    result.reserve(len);
+    size_t left = len;
+    for (Block *block = head_; left > 0; block = block->next)
+    {
+        size_t n = std::min(left, block->readable());
+        result.append(block->data + block->readerIndex, n);
+        left -= n;
+    }
+    retrieve(len);
+    return result;
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    readable_ += len;
+    while (len > 0)
+    {
+        if (tail_ == nullptr || tail_->writable() == 0)
+        {
+            pushBack(allocBlock());
+        }
+        size_t n = std::min(len, tail_->writable());
+        ::memcpy(tail_->data + tail_->writerIndex, data, n);
+        tail_->writerIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::prepend(const void *data, size_t len)
+{
+    const char *d = static_cast<const char*>(data);
+    readable_ += len;
+    while (len > 0)
+    {
+        if (head_ == nullptr || head_->readerIndex == 0)
+        {
+            // 新的头块，数据从块尾往前写
+            Block *block = allocBlock();
+            block->readerIndex = block->writerIndex = kBlockSize;
+            block->next = head_;
+            head_ = block;
+            if (tail_ == nullptr)
+            {
+                tail_ = block;
+            }
+        }
+        size_t n = std::min(len, head_->readerIndex);
+        head_->readerIndex -= n;
+        ::memcpy(head_->data + head_->readerIndex, d + len - n, n);
+        len -= n;
+    }
+}
+
+ssize_t ChainBuffer::readFd(int fd, int *saveErrno)
+{
+    struct iovec vec[1 + kReadBlocks];
+    Block *fresh[kReadBlocks];
+    int iovcnt = 0;
+
+    if (tail_ && tail_->writable() > 0)
+    {
+        vec[iovcnt].iov_base = tail_->data + tail_->writerIndex;
+        vec[iovcnt].iov_len = tail_->writable();
+        ++iovcnt;
+    }
+    for (int i = 0; i < kReadBlocks; ++i)
+    {
+        fresh[i] = allocBlock();
+        vec[iovcnt].iov_base = fresh[i]->data + fresh[i]->writerIndex;
+        vec[iovcnt].iov_len = fresh[i]->writable();
+        ++iovcnt;
+    }
+
+    const ssize_t n = ::readv(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+
+    // 按顺序把读到的字节记到尾块和新块上，没用到的新块释放
+    size_t left = n > 0 ? n : 0;
+    readable_ += left;
+    if (tail_ && left > 0)
+    {
+        size_t m = std::min(left, tail_->writable());
+        tail_->writerIndex += m;
+        left -= m;
+    }
+    for (int i = 0; i < kReadBlocks; ++i)
+    {
+        if (left > 0)
+        {
+            size_t m = std::min(left, fresh[i]->writable());
+            fresh[i]->writerIndex += m;
+            left -= m;
+            pushBack(fresh[i]);
+        }
+        else
+        {
+            freeBlock(fresh[i]);
+        }
+    }
+    return n;
+}
+
+int ChainBuffer::fillIovec(struct iovec *vec, int max) const
+{
+    int count = 0;
+    for (Block *block = head_; block && count < max; block = block->next)
+    {
+        if (block->readable() > 0)
+        {
+            vec[count].iov_base = block->data + block->readerIndex;
+            vec[count].iov_len = block->readable();
+            ++count;
+        }
+    }
+    return count;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno)
+{
+    return writeFd(fd, nullptr, 0, saveErrno);
+}
+
+ssize_t ChainBuffer::writeFd(int fd, const struct iovec *extra, int extraCount, int *saveErrno)
+{
+    struct iovec vec[kMaxIovecs * 2];
+    int iovcnt = fillIovec(vec, kMaxIovecs);
+    // 本缓冲的块没有全部放进去的话，后面的片段不能跳过它们先写
+    if (iovcnt < kMaxIovecs)
+    {
+        for (int i = 0; i < extraCount && i < kMaxIovecs; ++i)
+        {
+            vec[iovcnt++] = extra[i];
+        }
+    }
+
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
@@ -0,0 +1,90 @@
+// 分块链式缓冲，接口和Buffer一致，数据存放在固定大小的块组成的链表里
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <sys/types.h>
+
+struct iovec;
+class BufferPool;
+
+/**
+ * | block | -> | block | -> | block |
+ * 每个块: | prependable | readable | writable |
+ *
+ * 和Buffer相比：
+ * append只会在尾块写或者挂新块，已有的数据永远不会被搬动（没有resize和memmove）
+ * readFd用readv直接读进尾块和新块，writeFd用writev一次写出多个块
+ * 数据全部读完后块就释放了，空的ChainBuffer不占内存
+ * 代价是可读数据不一定连续，peek()只返回第一个块里连续的部分，长度见contiguousBytes()
+*/
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t kBlockSize = 16 * 1024; // 每个块的数据容量
+    static const size_t kCheapPrepend = 8; // 新的头块预留的prependable
+    static const int kMaxIovecs = 64; // writeFd一次最多写的片段数
+
+    explicit ChainBuffer(BufferPool *pool = nullptr);
+    ~ChainBuffer();
+
+    // 块从pool借用，必须在缓冲为空时设置；pool的块大小必须是blockAllocSize()
+    // pool不加锁，ChainBuffer的读写和析构（有数据时）都要在pool所属的线程
+    void setPool(BufferPool *pool) { pool_ = pool; }
+    static size_t blockAllocSize();
+
+    // 可读的长度
+    size_t readableBytes() const { return readable_; }
+    // 尾块剩余的可写长度，不够时append会挂新块
+    size_t writableBytes() const;
+    // 头块前面可以prepend的长度
+    size_t prependableBytes() const;
+    // 头块里连续可读的长度
+    size_t contiguousBytes() const;
+    // 头块里可读数据的首地址
+    const char *peek() const;
+    // 块的个数
+    size_t numBlocks() const { return numBlocks_; }
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAllAsString() { return retrieveAsString(readableBytes()); }
+    std::string retrieveAsString(size_t len);
+
+    // 把[data, data + len]添加到末尾，不会移动已有数据
+    void append(const char *data, size_t len);
+    // 添加到最前面，头块的prependable不够就在前面挂一个新块
+    void prepend(const void *data, size_t len);
+
+    // 从fd上读取数据，readv直接读进尾块和新块
+    ssize_t readFd(int fd, int *saveErrno);
+    // 从fd上写数据，writev一次写出多个块，不会retrieve，由调用者处理
+    ssize_t writeFd(int fd, int *saveErrno);
+    // 可读数据后面再接上extra里的片段一起writev
+    ssize_t writeFd(int fd, const struct iovec *extra, int extraCount, int *saveErrno);
+
+private:
+    struct Block
+    {
+        Block *next;
+        size_t readerIndex;
+        size_t writerIndex;
+        char data[kBlockSize];
+
+        size_t readable() const { return writerIndex - readerIndex; }
+        size_t writable() const { return kBlockSize - writerIndex; }
+    };
+
+    Block *allocBlock();
+    void freeBlock(Block *block);
+    void pushBack(Block *block);
+    // 可读数据填入vec，最多max个，返回个数
+    int fillIovec(struct iovec *vec, int max) const;
+
+    BufferPool *pool_; // nullptr则用new/delete
+    Block *head_;
+    Block *tail_;
+    size_t readable_;
+    size_t numBlocks_;
+};
@@ -10,7 +10,8 @@ const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;
 const int Channel::kWriteEvent = EPOLLOUT;
 
 Channel::Channel(EventLoop *loop, int fd)
-    : loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1), tied_(false)
+    : loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1), tied_(false), edgeTriggered_(false)
+    , describe_(nullptr), owner_(nullptr)
 {
 }
 
@@ -26,6 +27,20 @@ void Channel::tie(const std::shared_ptr<void> &obj) // 强转弱
     tied_ = true;
 }
 
+std::string Channel::description() const
+{
+    if (describe_)
+    {
+        return describe_(owner_);
+    }
+    return "fd=" + std::to_string(fd_);
+}
+
+std::string Channel::describeChannel(const void *channel)
+{
+    return static_cast<const Channel*>(channel)->description();
+}
+
 void Channel::update()
 {
     loop_->updateChannel(this);
@@ -54,12 +69,14 @@ void Channel::handleEvent(Timestamp receiveTime)
 
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-    LOG_INFO("channel handleEvent revents:%d\n", revents_);
+    LOG_DEBUG("channel handleEvent revents:%d\n", revents_);
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN))
     {
         if (closeCallback_)
         {
+            Timestamp start = loop_->slowCallbackStart();
             closeCallback_();
+            loop_->checkSlowCallback(EventLoop::kCloseCallback, &Channel::describeChannel, this, fd_, start);
         }
     }
 
@@ -67,7 +84,9 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
     {
         if (errorCallback_)
         {
+            Timestamp start = loop_->slowCallbackStart();
             errorCallback_();
+            loop_->checkSlowCallback(EventLoop::kErrorCallback, &Channel::describeChannel, this, fd_, start);
         }
     }
 
@@ -75,7 +94,9 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
     {
         if (readCallback_)
         {
+            Timestamp start = loop_->slowCallbackStart();
             readCallback_(receiveTime);
+            loop_->checkSlowCallback(EventLoop::kReadCallback, &Channel::describeChannel, this, fd_, start);
         }
     }
 
@@ -83,7 +104,9 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
     {
         if (writeCallback_)
         {
+            Timestamp start = loop_->slowCallbackStart();
             writeCallback_();
+            loop_->checkSlowCallback(EventLoop::kWriteCallback, &Channel::describeChannel, this, fd_, start);
         }
     }
 }
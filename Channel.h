@@ -7,17 +7,21 @@
 
 #include "noncopyable.h"
 #include "Timestamp.h"
+#include "InplaceFunction.h"
+#include "Callbacks.h"
 
 #include <functional>
 #include <memory> // weak_ptr
+#include <string>
 
 class EventLoop; // 先不要include，等到实际使用的时候，OOP思想
 
 class Channel : noncopyable
 {
 public:
-    using EventCallback = std::function<void()>; // C++11的using语法代替typedef
-    using ReadEventCallback = std::function<void(Timestamp)>;
+    // 只能移动的回调，bind到TcpConnection等对象上时不需要堆分配
+    using EventCallback = InplaceFunction<void()>; // C++11的using语法代替typedef
+    using ReadEventCallback = InplaceFunction<void(Timestamp)>;
 
     Channel(EventLoop *loop, int fd); // 指针则不需要EventLoop具体，都是4个字节
     ~Channel();
@@ -34,6 +38,11 @@ public:
     // 防止当channel被手动remove后，channel还在执行回调操作
     void tie(const std::shared_ptr<void>&);
 
+    // 慢回调报告里的描述，只在需要时调用describe(owner)生成，例如TcpConnection的名字
+    void setDescription(DescribeCallback describe, const void *owner) { describe_ = describe; owner_ = owner; }
+    // 没有设置时返回"fd=N"
+    std::string description() const;
+
     // 返回对象
     int fd() const { return fd_; }
     int events() const { return events_; }
@@ -47,6 +56,12 @@ public:
     void enableWriting() { events_ |= kWriteEvent; update(); }
     void disableWriting() { events_ &= ~kWriteEvent; update(); }
     void disableAll() { events_ = kNoneEvent; update(); }
+    // 读写事件一次注册，边缘触发模式下写事件常驻，不需要反复epoll_ctl
+    void enableAll() { events_ |= kReadEvent | kWriteEvent; update(); }
+
+    // 边缘触发（EPOLLET），需要在注册事件之前设置；回调必须把数据读写到EAGAIN为止
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
 
     // 返回fd当前的事件状态
     bool isNoneEvent() const { return events_ == kNoneEvent; }
@@ -68,6 +83,8 @@ private:
 
     // handleEvent()调用
     void handleEventWithGuard(Timestamp receiveTime);
+    // 慢回调报告用的描述
+    static std::string describeChannel(const void *channel);
 
     // 添加到poller的状态
     static const int kNoneEvent;
@@ -82,6 +99,9 @@ private:
 
     std::weak_ptr<void> tie_; // 弱智能指针
     bool tied_; // 是否绑定
+    bool edgeTriggered_; // 是否边缘触发
+    DescribeCallback describe_;
+    const void *owner_;
 
     // 由于channel通道可以获知fd发生的具体事件revents，所以它负责执行具体事件的回调操作
     ReadEventCallback readCallback_; // read事件需要时间戳
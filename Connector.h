@@ -0,0 +1,66 @@
+// 主动发起的非阻塞连接，TcpClient使用
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerId.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class Channel;
+class EventLoop;
+
+/**
+ * 非阻塞connect：EINPROGRESS时监听可写事件，可写后用SO_ERROR判断是否连上
+ * 连接失败按指数退避重试，从kInitRetryDelayMs开始每次翻倍，最多kMaxRetryDelayMs
+ * 连上之后把sockfd交给NewConnectionCallback，之后的读写由TcpConnection负责
+ * 必须由shared_ptr管理：重试定时器和延迟任务持有它，保证回调时对象还在
+*/
+class Connector : noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+    const InetAddress& serverAddress() const { return serverAddr_; }
+
+    // 开始连接，任意线程调用
+    void start();
+    // 连接断开后重新连接，重置退避时间，只能在loop线程调用
+    void restart();
+    // 停止连接和重试，任意线程调用
+    void stop();
+
+private:
+    enum StateE { kDisconnected, kConnecting, kConnected };
+    static const int kMaxRetryDelayMs = 30 * 1000;
+    static const int kInitRetryDelayMs = 500;
+
+    void setState(StateE state) { state_ = state; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    // connect已经发起，等待可写
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    // 关闭sockfd，按退避时间重新连接
+    void retry(int sockfd);
+    // 从poller移除channel并返回它的fd，channel_本身在之后的任务里释放
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_; // 用户是否希望连接
+    StateE state_; // 只在loop线程读写
+    std::unique_ptr<Channel> channel_; // 正在连接的sockfd
+    NewConnectionCallback newConnectionCallback_;
+    int retryDelayMs_;
+    TimerId retryTimer_;
+};
@@ -1,6 +1,8 @@
 // Poller的newDefaultPoller()实现
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "Logger.h"
 
 #include <stdlib.h> // getenv
 
@@ -10,6 +12,17 @@ Poller* Poller::newDefaultPoller(EventLoop *loop)
     {
         return nullptr;
     }
+    else if (::getenv("MUDUO_USE_IOURING")) // io_uring，创建失败就退回epoll
+    {
+        IoUringPoller *poller = new IoUringPoller(loop);
+        if (poller->valid())
+        {
+            return poller;
+        }
+        delete poller;
+        LOG_ERROR("io_uring unavailable, fall back to epoll \n");
+        return new EPollPoller(loop);
+    }
     else
     {
         return new EPollPoller(loop); // 生成epoll实例
@@ -26,6 +26,7 @@ public:
     void updateChannel(Channel *channel) override;
     // 从poller（epoll队列）中删除channel 
     void removeChannel(Channel *channel) override; 
+    const char* name() const override { return "epoll"; }
 
 private:
     static const int kInitEventListSize = 16;
@@ -2,12 +2,19 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include "BufferPool.h"
+#include "ObjectPool.h"
+#include "ChainBuffer.h"
+#include "Buffer.h"
 
 #include <sys/eventfd.h> // eventfd
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <memory>
+#include <algorithm>
 
 // 防止一个线程创建多个EventLoop； __thread把变量设为thread_local
 __thread EventLoop *t_loopInThisThread = nullptr;
@@ -15,6 +22,9 @@ __thread EventLoop *t_loopInThisThread = nullptr;
 // 默认的poller IO复用接口的超时时间
 const int kPollTimeMs = 10000;
 
+// 缓冲块池回收空闲块的周期
+const double kBufferPoolTrimSeconds = 10.0;
+
 // 创建wakeupfd，用来notify唤醒subReactor处理新的channel
 int createEventfd()
 {
@@ -30,10 +40,17 @@ EventLoop::EventLoop()
     : looping_(false)
 	, quit_(false)
 	, callingPendingFunctors_(false)
+	, activeConnections_(0)
+	, busyMicroSeconds_(0)
 	, threadId_(CurrentThread::tid())
 	, poller_(Poller::newDefaultPoller(this))
+	, timerQueue_(new TimerQueue(this))
+	, bufferPool_(new BufferPool(ChainBuffer::blockAllocSize()))
+	, objectPool_(std::make_shared<ObjectPool>())
 	, wakeupFd_(createEventfd())
 	, wakeupChannel_(new Channel(this, wakeupFd_))
+	, slowThresholdMicros_(0)
+	, wakeupPending_(false)
 {
     LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
     if (t_loopInThisThread) // 确保one loop per thread
@@ -50,6 +67,8 @@ EventLoop::EventLoop()
     wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
     // 每个eventLoop都会监听wakeupChannel的EPOLLIN读事件
     wakeupChannel_->enableReading();
+
+    runEvery(kBufferPoolTrimSeconds, std::bind(&BufferPool::trim, bufferPool_.get()));
 }
 
 EventLoop::~EventLoop()
@@ -67,10 +86,22 @@ void EventLoop::loop()
 
     LOG_INFO("EventLoop %p start looping \n", this); // 输出地址/指针
 
+    const int64_t growthBase = t_bufferGrowths; // 本线程之前的Buffer扩容不算在这个loop上
+    Timestamp iterationEnd = Timestamp::now();
     while (!quit_)
     {
         activeChannels_.clear();
         pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        int64_t events = static_cast<int64_t>(activeChannels_.size());
+        polls_.add(1);
+        eventsDispatched_.add(events);
+        maxEventsPerPoll_.setMax(events);
+        int64_t wait = timeDifferenceMicros(pollReturnTime_, iterationEnd);
+        if (wait > 0)
+        {
+            pollWaitMicros_.add(wait);
+        }
+
         for (Channel *channel : activeChannels_)
         {
             // EventLoop通知channel处理相应事件
@@ -83,6 +114,22 @@ void EventLoop::loop()
          * mainLoop会事先注册cb，在wakeup subLoop后，由subLoop执行cb
          */
         doPendingFunctors();
+
+        // 从poll返回到处理完回调都算忙碌时间
+        iterationEnd = Timestamp::now();
+        int64_t busy = timeDifferenceMicros(iterationEnd, pollReturnTime_);
+        if (busy > 0) // 系统时间被往回调时忽略
+        {
+            busyMicroSeconds_.store(busyMicroSeconds_.load(std::memory_order_relaxed) + busy,
+                                    std::memory_order_relaxed);
+        }
+        lagBuckets_[LoopMetrics::lagBucket(busy)].add(1);
+        // 这一轮已经报告过慢回调时不再重复报告整轮
+        if (slowCallbackCheck() && busy >= slowThresholdMicros_ && lastSlowStart_ < pollReturnTime_)
+        {
+            reportSlowCallback(kIteration, nullptr, nullptr, -1, pollReturnTime_, busy);
+        }
+        bufferGrowths_.set(t_bufferGrowths - growthBase);
     }
 
     LOG_INFO("EventLoop %p stop looping. \n", this);
@@ -105,7 +152,7 @@ void EventLoop::quit()
     }
 }
 
-void EventLoop::runInLoop(Functor cb)
+void EventLoop::runInLoop(Functor &&cb, DescribeCallback describe, const void *owner)
 {
     if (isInLoopThread())
     {
@@ -113,24 +160,57 @@ void EventLoop::runInLoop(Functor cb)
     }
     else
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb), describe, owner);
     }
 }
 
-void EventLoop::queueInLoop(Functor cb)
+void EventLoop::queueInLoop(Functor &&cb, DescribeCallback describe, const void *owner)
 {
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
-    }
+    Task task;
+    task.functor = std::move(cb);
+    task.describe = describe;
+    task.owner = owner;
+    pendingFunctors_.push(std::move(task));
 
     // callingPendingFunctors_表示当前loop正在执行cb，但有了新cb，为了不让loop函数的poll阻塞，需要唤醒然后继续执行cb
-    if (!isInLoopThread() || callingPendingFunctors_)
+    // 必须在push完成之后检查wakeupPending_：已经有人唤醒过、loop还没开始取回调的话，loop一定能取到这个cb
+    if ((!isInLoopThread() || callingPendingFunctors_) && !wakeupPending_.exchange(true))
     {
         wakeup();
     }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+TimingWheel *EventLoop::timingWheel()
+{
+    if (!timingWheel_)
+    {
+        timingWheel_.reset(new TimingWheel(this));
+    }
+    return timingWheel_.get();
+}
+
 void EventLoop::handleRead()
 {
     uint64_t one = 1;                              // 8个字节
@@ -167,24 +247,134 @@ bool EventLoop::hasChannel(Channel *channel)
     return poller_->hasChannel(channel);
 }
 
+const char* EventLoop::pollerName() const
+{
+    return poller_->name();
+}
+
+LoopMetrics EventLoop::metrics() const
+{
+    LoopMetrics m;
+    m.polls = polls_.get();
+    m.pollWaitMicros = pollWaitMicros_.get();
+    m.busyMicros = busyMicroSeconds();
+    m.eventsDispatched = eventsDispatched_.get();
+    m.maxEventsPerPoll = maxEventsPerPoll_.get();
+    m.functorsRun = functorsRun_.get();
+    m.functorDrainMicros = functorDrainMicros_.get();
+    m.lastFunctorBatch = lastFunctorBatch_.get();
+    m.maxFunctorBatch = maxFunctorBatch_.get();
+    m.activeConnections = activeConnections();
+    m.bytesRead = bytesRead_.get();
+    m.bytesWritten = bytesWritten_.get();
+    m.bufferGrowths = bufferGrowths_.get();
+    m.highWaterMarkHits = highWaterMarkHits_.get();
+    m.slowCallbacks = slowCallbacks_.get();
+    for (int i = 0; i < LoopMetrics::kLagBuckets; ++i)
+    {
+        m.lagBuckets[i] = lagBuckets_[i].get();
+    }
+    m.loops = 1;
+    return m;
+}
+
+const char* EventLoop::callbackKindName(CallbackKind kind)
+{
+    switch (kind)
+    {
+    case kReadCallback: return "read";
+    case kWriteCallback: return "write";
+    case kCloseCallback: return "close";
+    case kErrorCallback: return "error";
+    case kFunctor: return "functor";
+    case kTimer: return "timer";
+    case kTimeout: return "timeout";
+    case kIteration: return "iteration";
+    }
+    return "unknown";
+}
+
+void EventLoop::setSlowCallbackThreshold(double thresholdSeconds, SlowCallbackHandler handler)
+{
+    slowThresholdMicros_ = thresholdSeconds > 0
+        ? std::max<int64_t>(1, static_cast<int64_t>(thresholdSeconds * Timestamp::kMicroSecondsPerSecond))
+        : 0;
+    slowCallbackHandler_ = std::move(handler);
+}
+
+void EventLoop::finishSlowCheck(CallbackKind kind, DescribeCallback describe, const void *owner, int fd, Timestamp start)
+{
+    int64_t micros = timeDifferenceMicros(Timestamp::now(), start);
+    // 在这个回调里开始的回调已经报告过了，报告最里层的就够了
+    if (micros >= slowThresholdMicros_ && lastSlowStart_ < start)
+    {
+        reportSlowCallback(kind, describe, owner, fd, start, micros);
+    }
+}
+
+void EventLoop::reportSlowCallback(CallbackKind kind, DescribeCallback describe, const void *owner, int fd,
+                                   Timestamp start, int64_t micros)
+{
+    slowCallbacks_.add(1);
+    lastSlowStart_ = start;
+    SlowCallback slow;
+    slow.kind = kind;
+    slow.name = describe ? describe(owner) : std::string();
+    slow.fd = fd;
+    slow.start = start;
+    slow.micros = micros;
+    if (slowCallbackHandler_)
+    {
+        slowCallbackHandler_(slow);
+    }
+    else
+    {
+        LOG_ERROR("EventLoop %p slow %s callback [%s] fd=%d took %lld us\n", this, callbackKindName(kind),
+            slow.name.c_str(), slow.fd, static_cast<long long>(micros));
+    }
+}
+
 void EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
+    // 先清除标志再取回调：之后投递的cb要么被这次取到，要么会重新唤醒loop
+    wakeupPending_.exchange(false);
 
+    /**
+     * 先把当前队列里的cb全部取出再执行，
+     * 执行过程中新加入的cb留到下一轮，避免一直有cb加入时loop无法回到poll
+    */
+    Task task;
+    while (pendingFunctors_.pop(task))
     {
-        std::unique_lock<std::mutex> lock(mutex_); // 出了作用域，锁就没了
-        /**
-         * swap原因：在queueInLoop加入cb的时候，没有办法去执行cb，
-         * 而swap之后，虽然pendingFunctors_为空，不影响加入cb，
-         * 同时也保证cb的及时执行
-        */        
-        functors.swap(pendingFunctors_);
+        runningFunctors_.push_back(std::move(task));
     }
 
-    for (const Functor &functor : functors)
+    int64_t batch = static_cast<int64_t>(runningFunctors_.size());
+    lastFunctorBatch_.set(batch);
+    if (batch > 0)
     {
-        functor(); // 执行当前loop需要执行的回调操作
+        maxFunctorBatch_.setMax(batch);
+        Timestamp start = Timestamp::now();
+        if (slowCallbackCheck())
+        {
+            for (const Task &t : runningFunctors_)
+            {
+                Timestamp functorStart = Timestamp::now();
+                t.functor();
+                checkSlowCallback(kFunctor, t.describe, t.owner, -1, functorStart);
+            }
+        }
+        else
+        {
+            for (const Task &t : runningFunctors_)
+            {
+                t.functor(); // 执行当前loop需要执行的回调操作
+            }
+        }
+        runningFunctors_.clear();
+        functorsRun_.add(batch);
+        functorDrainMicros_.add(timeDifferenceMicros(Timestamp::now(), start));
     }
 
     callingPendingFunctors_ = false; // 结束回调
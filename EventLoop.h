@@ -2,22 +2,32 @@
 
 #include <functional>
 #include <vector>
+#include <string>
 #include <atomic>
-#include <memory> // unique_ptr
-#include <mutex>
+#include <memory> // unique_ptr shared_ptr
 
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "MpscQueue.h"
+#include "InplaceFunction.h"
+#include "LoopMetrics.h"
 
 class Channel;
 class Poller;
+class TimerQueue;
+class TimingWheel;
+class BufferPool;
+class ObjectPool;
 
 // 事件循环类 主要包含了Channel Poller(epoll的抽象)
 class EventLoop : noncopyable
 {
 public:
-    using Functor = std::function<void()>;
+    // 只能移动，常见的bind（成员函数指针加shared_ptr和几个参数）不需要堆分配
+    using Functor = InplaceFunction<void()>;
 
     EventLoop();
     ~EventLoop();
@@ -31,9 +41,28 @@ public:
     Timestamp pollReturnTime() const { return pollReturnTime_; }
 
     // 执行cb并判断是否在当前loop中
-    void runInLoop(Functor cb);
-    // 把cb放入队列中，唤醒loop相应线程，执行cb
-    void queueInLoop(Functor cb);
+    // describe(owner)是cb所属对象的描述，开启慢回调检测时用于报告，owner要在cb执行完之前一直有效
+    void runInLoop(Functor &&cb, DescribeCallback describe = nullptr, const void *owner = nullptr);
+    // 把cb放入队列中，唤醒loop相应线程，执行cb；不加锁，上一次唤醒还没被处理时不再重复写eventfd
+    void queueInLoop(Functor &&cb, DescribeCallback describe = nullptr, const void *owner = nullptr);
+
+    // 定时器，线程安全，回调在loop所在线程执行
+    // 在time时刻执行cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // delay秒后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器
+    void cancel(TimerId timerId);
+
+    // 本loop的时间轮，第一次使用时创建，只能在loop线程调用
+    TimingWheel* timingWheel();
+
+    // 本loop的缓冲块池，连接的发送缓冲从这里借块；统计数据可以跨线程读取
+    BufferPool* bufferPool() const { return bufferPool_.get(); }
+    // 本loop的连接对象池，TcpServer在本loop线程里用allocate_shared从这里分配连接
+    const std::shared_ptr<ObjectPool>& objectPool() const { return objectPool_; }
 
     // 唤醒loop所在线程
     void wakeup();
@@ -42,24 +71,96 @@ public:
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
     bool hasChannel(Channel *channel);
+    // 实际使用的poller，MUDUO_USE_IOURING时也可能因为io_uring不可用退回epoll
+    const char* pollerName() const;
 
     // 判断EventLoop对象是否在自己的线程
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
+
+    // 负载计数，任意线程都可以读，EventLoopThreadPool据此选择subLoop
+    // 分配到本loop、还没销毁的连接数
+    int activeConnections() const { return activeConnections_.load(std::memory_order_relaxed); }
+    // 累计处理事件和回调花费的时间（微秒），两次读数相减得到这段时间的忙碌程度
+    int64_t busyMicroSeconds() const { return busyMicroSeconds_.load(std::memory_order_relaxed); }
+    // 连接分配到本loop时加一，连接销毁时减一
+    void addActiveConnections(int delta) { activeConnections_.fetch_add(delta, std::memory_order_relaxed); }
+
+    // 运行统计的快照，任意线程调用；计数只由loop线程写，读取不加锁
+    LoopMetrics metrics() const;
+    // 本loop上的连接在loop线程里报告收发字节数和越过高水位
+    void addBytesRead(size_t n) { bytesRead_.add(static_cast<int64_t>(n)); }
+    void addBytesWritten(size_t n) { bytesWritten_.add(static_cast<int64_t>(n)); }
+    void addHighWaterMarkHit() { highWaterMarkHits_.add(1); }
+
+    // 慢回调检测报告的回调类型
+    enum CallbackKind
+    {
+        kReadCallback,
+        kWriteCallback,
+        kCloseCallback,
+        kErrorCallback,
+        kFunctor, // queueInLoop/runInLoop投递的回调
+        kTimer, // runAt/runAfter/runEvery的定时器回调
+        kTimeout, // 时间轮上到期的Entry，例如连接的空闲超时
+        kIteration, // 整轮循环，单个回调都不慢但加起来超过阈值
+    };
+    static const char* callbackKindName(CallbackKind kind);
+
+    struct SlowCallback
+    {
+        CallbackKind kind;
+        std::string name; // 回调所属对象的描述，例如TcpConnection的名字；不知道时为空
+        int fd; // channel的fd，没有时为-1
+        Timestamp start;
+        int64_t micros; // 耗时
+    };
+    using SlowCallbackHandler = std::function<void(const SlowCallback&)>;
+
+    /**
+     * 慢回调检测：开启后给每个channel回调、投递的回调、定时器和时间轮回调计时，
+     * 单个回调或者一整轮循环耗时达到thresholdSeconds就在loop线程里调用handler报告，handler为空时打印日志
+     * 回调里嵌套的回调（例如定时器里执行的时间轮Entry）已经报告过时，外层不再重复报告
+     * thresholdSeconds<=0关闭，关闭时不读时钟，没有额外开销
+     * 只能在loop线程里或者loop开始之前调用；多个loop用EventLoopThreadPool的ThreadInitCallback逐个设置
+    */
+    void setSlowCallbackThreshold(double thresholdSeconds,
+                                  SlowCallbackHandler handler = SlowCallbackHandler());
+    bool slowCallbackCheck() const { return slowThresholdMicros_ > 0; }
+    // 开启了检测时返回当前时间，否则返回无效时间
+    Timestamp slowCallbackStart() const { return slowCallbackCheck() ? Timestamp::now() : Timestamp::invalid(); }
+    // 回调执行完后用开始时间检查耗时，超过阈值就报告；describe(owner)在报告时生成名字，owner此时必须还有效
+    void checkSlowCallback(CallbackKind kind, DescribeCallback describe, const void *owner, int fd, Timestamp start)
+    {
+        if (start.valid() && slowCallbackCheck()) // 回调里可能关闭了检测
+        {
+            finishSlowCheck(kind, describe, owner, fd, start);
+        }
+    }
 private:
     // subLoop执行，通过监听wakeupFd_被唤醒，处理mainReactor发送的新用户channel
     void handleRead();
     // 执行回调
     void doPendingFunctors();
+    void finishSlowCheck(CallbackKind kind, DescribeCallback describe, const void *owner, int fd, Timestamp start);
+    void reportSlowCallback(CallbackKind kind, DescribeCallback describe, const void *owner, int fd,
+                            Timestamp start, int64_t micros);
 
     using ChannelList = std::vector<Channel*>;
 
     std::atomic_bool looping_; // 原子操作
     std::atomic_bool quit_; // 标识退出loop循环
+	std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有要执行的回调
+    std::atomic_int activeConnections_;
+    std::atomic<int64_t> busyMicroSeconds_; // 只有loop线程写
 
     const pid_t threadId_; // 当前loop线程的tid
     
     Timestamp pollReturnTime_; // poller返回发生事件的时间
     std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timerQueue_; // 依赖poller_，必须在其后构造
+    std::unique_ptr<TimingWheel> timingWheel_; // 依赖timerQueue_
+    std::unique_ptr<BufferPool> bufferPool_;
+    std::shared_ptr<ObjectPool> objectPool_; // 连接的分配器也持有它，可能比loop活得久
 
     // 当mainLoop获取一个新用户的channel，轮询选择一个subloop，用wakeupFd_唤醒以处理channel
     int wakeupFd_; 
@@ -67,7 +168,38 @@ private:
 
     ChannelList activeChannels_;
 
-	std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有要执行的回调
-	std::vector<Functor> pendingFunctors_; // 存储loop需要执行的所有回调
-    std::mutex mutex_; // 互斥锁，保护上面vector容器的线程安全
+    // 队列里的回调和它所属对象的描述
+    struct Task
+    {
+        Functor functor;
+        DescribeCallback describe = nullptr;
+        const void *owner = nullptr;
+    };
+    std::vector<Task> runningFunctors_; // doPendingFunctors从队列取出的回调，复用容量
+
+    // 运行统计，见LoopMetrics
+    LoopCounter polls_;
+    LoopCounter pollWaitMicros_;
+    LoopCounter eventsDispatched_;
+    LoopCounter maxEventsPerPoll_;
+    LoopCounter functorsRun_;
+    LoopCounter functorDrainMicros_;
+    LoopCounter lastFunctorBatch_;
+    LoopCounter maxFunctorBatch_;
+    LoopCounter bytesRead_;
+    LoopCounter bytesWritten_;
+    LoopCounter bufferGrowths_;
+    LoopCounter highWaterMarkHits_;
+    LoopCounter slowCallbacks_;
+    LoopCounter lagBuckets_[LoopMetrics::kLagBuckets];
+
+    int64_t slowThresholdMicros_; // 0表示不检测
+    Timestamp lastSlowStart_; // 最近一次报告的回调的开始时间，外层回调据此判断里面是否已经报告过
+    SlowCallbackHandler slowCallbackHandler_;
+
+    // 上面的loop状态和下面生产者线程频繁修改的字段分开在不同的缓存行
+    char padState_[kCacheLineSize];
+    std::atomic_bool wakeupPending_; // 已经写过eventfd、loop还没开始处理回调
+    char padWakeup_[kCacheLineSize - sizeof(std::atomic_bool)];
+    MpscQueue<Task> pendingFunctors_; // 存储loop需要执行的所有回调，其他线程无锁投递
 };
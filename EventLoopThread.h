@@ -21,6 +21,10 @@ public:
         const std::string &name = std::string());
     ~EventLoopThread();
 
+    // 在startLoop之前设置loop线程的位置，见Thread::setCpuAffinity/setNumaLocal
+    void setCpuAffinity(int cpu) { thread_.setCpuAffinity(cpu); }
+    void setNumaLocal(bool on) { thread_.setNumaLocal(on); }
+
     // 开启一个loop和线程，返回loop
     EventLoop* startLoop();
 private:
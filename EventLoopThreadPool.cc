@@ -1,7 +1,14 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
 
 #include <memory>
+#include <sched.h>
+#include <sys/socket.h>
+
+// kLeastBusy重新采样的周期
+const int64_t kBusySampleMicros = 100 * 1000;
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
     : baseLoop_(baseLoop)
@@ -9,6 +16,10 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string
 	, started_(false)
 	, numThreads_(0)
 	, next_(0)
+	, policy_(kRoundRobin)
+	, random_(reinterpret_cast<uintptr_t>(this) | 1)
+	, pinToCores_(false)
+	, numaLocal_(false)
 {}
 
 // 不需要考虑loop的析构，它在EventLoopThread是在作用域中定义的
@@ -19,15 +30,39 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 {
     started_ = true;
 
+    std::vector<int> cpus = cpus_;
+    if (cpus.empty() && pinToCores_)
+    {
+        // 进程允许运行的cpu，taskset/cgroup限制过的话只用这些
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (::sched_getaffinity(0, sizeof allowed, &allowed) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &allowed))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+    }
+
     for (int i = 0; i < numThreads_; ++i)
     {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
         EventLoopThread *t = new EventLoopThread(cb, buf);
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        t->setCpuAffinity(cpu);
+        t->setNumaLocal(numaLocal_);
+        loopCpus_.push_back(cpu);
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         // 创建线程后开启loop
         loops_.push_back(t->startLoop());
     }
+    lastBusy_.assign(loops_.size(), 0);
+    recentBusy_.assign(loops_.size(), 0);
 
     // 只有一个baseLoop
     if (numThreads_ == 0 && cb)
@@ -53,6 +88,136 @@ EventLoop *EventLoopThreadPool::getNextLoop()
     return loop;
 }
 
+EventLoop *EventLoopThreadPool::getNextLoop(int sockfd, const InetAddress &peerAddr)
+{
+    if (loops_.size() <= 1)
+    {
+        return getNextLoop();
+    }
+
+    switch (policy_)
+    {
+    case kLeastConnections:
+        return leastConnections();
+    case kLeastBusy:
+        return leastBusy();
+    case kPowerOfTwoChoices:
+        return powerOfTwoChoices();
+    case kPeerHash:
+        return peerHash(peerAddr);
+    case kIncomingCpu:
+        return incomingCpu(sockfd);
+    case kCustom:
+        if (selector_)
+        {
+            EventLoop *loop = selector_(loops_, sockfd, peerAddr);
+            if (loop)
+            {
+                return loop;
+            }
+        }
+        return getNextLoop();
+    case kRoundRobin:
+    default:
+        return getNextLoop();
+    }
+}
+
+EventLoop *EventLoopThreadPool::leastConnections()
+{
+    // 连接数相同时从轮询位置开始找，避免总是压到第一个loop上
+    size_t n = loops_.size();
+    size_t start = next_;
+    next_ = (next_ + 1) % n;
+    EventLoop *best = loops_[start];
+    for (size_t i = 1; i < n; ++i)
+    {
+        EventLoop *loop = loops_[(start + i) % n];
+        if (loop->activeConnections() < best->activeConnections())
+        {
+            best = loop;
+        }
+    }
+    return best;
+}
+
+void EventLoopThreadPool::sampleBusy()
+{
+    Timestamp now(Timestamp::now());
+    if (lastSample_.valid() && timeDifferenceMicros(now, lastSample_) < kBusySampleMicros)
+    {
+        return;
+    }
+    lastSample_ = now;
+    for (size_t i = 0; i < loops_.size(); ++i)
+    {
+        int64_t busy = loops_[i]->busyMicroSeconds();
+        recentBusy_[i] = busy - lastBusy_[i];
+        lastBusy_[i] = busy;
+    }
+}
+
+EventLoop *EventLoopThreadPool::leastBusy()
+{
+    sampleBusy();
+    // 忙碌时间相同（比如都空闲）时取连接数少的
+    size_t n = loops_.size();
+    size_t start = next_;
+    next_ = (next_ + 1) % n;
+    size_t best = start;
+    for (size_t i = 1; i < n; ++i)
+    {
+        size_t index = (start + i) % n;
+        if (recentBusy_[index] < recentBusy_[best]
+            || (recentBusy_[index] == recentBusy_[best]
+                && loops_[index]->activeConnections() < loops_[best]->activeConnections()))
+        {
+            best = index;
+        }
+    }
+    return loops_[best];
+}
+
+EventLoop *EventLoopThreadPool::powerOfTwoChoices()
+{
+    // xorshift64，只在baseLoop线程调用，不需要加锁
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
+    size_t n = loops_.size();
+    size_t first = random_ % n;
+    size_t second = (first + 1 + (random_ >> 32) % (n - 1)) % n; // 和first不同
+    EventLoop *a = loops_[first];
+    EventLoop *b = loops_[second];
+    return b->activeConnections() < a->activeConnections() ? b : a;
+}
+
+EventLoop *EventLoopThreadPool::peerHash(const InetAddress &peerAddr)
+{
+    // 只用ip不用端口，同一客户端的多个连接落在同一个loop上
+    uint32_t ip = peerAddr.getSockAddr()->sin_addr.s_addr;
+    uint32_t hash = ip * 2654435761u; // Knuth乘法哈希
+    return loops_[hash % loops_.size()];
+}
+
+EventLoop *EventLoopThreadPool::incomingCpu(int sockfd)
+{
+    // 内核处理这个连接收包软中断的cpu
+    int cpu = -1;
+    socklen_t len = sizeof cpu;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0 && cpu >= 0)
+    {
+        for (size_t i = 0; i < loopCpus_.size(); ++i)
+        {
+            if (loopCpus_[i] == cpu)
+            {
+                return loops_[i];
+            }
+        }
+    }
+    return getNextLoop();
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
 {
     if (loops_.empty())
@@ -64,3 +229,23 @@ std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
         return loops_;
     }
 }
+
+std::vector<LoopMetrics> EventLoopThreadPool::loopMetrics()
+{
+    std::vector<LoopMetrics> result;
+    for (EventLoop *loop : getAllLoops())
+    {
+        result.push_back(loop->metrics());
+    }
+    return result;
+}
+
+LoopMetrics EventLoopThreadPool::metrics()
+{
+    LoopMetrics total;
+    for (EventLoop *loop : getAllLoops())
+    {
+        total.merge(loop->metrics());
+    }
+    return total;
+}
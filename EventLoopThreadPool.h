@@ -1,36 +1,88 @@
 #pragma once
 
 #include "noncopyable.h"
+#include "Timestamp.h"
+#include "LoopMetrics.h"
 
 #include <functional>
 #include <string>
 #include <vector>
 #include <memory>
+#include <stdint.h>
 
 class EventLoop; // 如果在实现中引用到具体方法/变量，就需要include
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool : noncopyable
 {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
+    // 自定义的选择策略，从subLoop中为peerAddr的新连接选一个
+    using LoopSelector = std::function<EventLoop*(const std::vector<EventLoop*> &loops,
+                                                  int sockfd, const InetAddress &peerAddr)>;
+
+    // 新连接分配到subLoop的策略
+    enum SelectPolicy
+    {
+        kRoundRobin, // 轮询
+        kLeastConnections, // 当前连接数最少
+        kLeastBusy, // 最近一段时间处理事件的耗时最少
+        kPowerOfTwoChoices, // 随机挑两个，取连接数少的
+        kPeerHash, // 按对端ip哈希，同一个客户端总落在同一个loop上
+        kIncomingCpu, // 交给绑定在处理该连接网卡中断的cpu（SO_INCOMING_CPU）上的loop，找不到时轮询
+        kCustom, // setLoopSelector设置的自定义策略
+    };
 
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
 
+    // 只能在baseLoop所在线程调用
+    void setSelectPolicy(SelectPolicy policy) { policy_ = policy; }
+    void setLoopSelector(LoopSelector selector) { selector_ = std::move(selector); policy_ = kCustom; }
+
+    /**
+     * subLoop线程的位置，需要在start之前设置
+     * setCpuList：第i个subLoop绑定到cpus[i % cpus.size()]
+     * setPinToCores：按进程允许使用的cpu依次一个loop绑一个核，setCpuList优先
+     * setNumaLocal：loop线程的内存从所在NUMA节点分配，配合绑核使用
+     * 把网卡队列的中断绑定到这些cpu上，再用kIncomingCpu或TcpServer::kReusePortPerLoop，
+     * 连接就由处理其中断的cpu上的loop负责
+    */
+    void setCpuList(std::vector<int> cpus) { cpus_ = std::move(cpus); }
+    void setPinToCores(bool on) { pinToCores_ = on; }
+    void setNumaLocal(bool on) { numaLocal_ = on; }
+    // 第index个subLoop绑定的cpu，没有绑定为-1
+    int loopCpu(size_t index) const { return index < loopCpus_.size() ? loopCpus_[index] : -1; }
+
     // 开启子线程并执行回调
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
     // baseLoop_轮询分配channel给subLoop
     EventLoop* getNextLoop();
+    // 按设置的策略为sockfd上peerAddr的新连接选一个subLoop
+    EventLoop* getNextLoop(int sockfd, const InetAddress &peerAddr);
 
     std::vector<EventLoop*> getAllLoops();
 
+    // 各loop运行统计的快照，顺序和getAllLoops一致，任意线程调用
+    std::vector<LoopMetrics> loopMetrics();
+    // 所有loop合并后的统计
+    LoopMetrics metrics();
+
     bool started() const { return started_; }
     const std::string name() const { return name_; }
 private:
+    EventLoop* leastConnections();
+    EventLoop* leastBusy();
+    EventLoop* powerOfTwoChoices();
+    EventLoop* peerHash(const InetAddress &peerAddr);
+    EventLoop* incomingCpu(int sockfd);
+    // 每隔一段时间根据各loop的累计忙碌时间计算最近的忙碌时间
+    void sampleBusy();
+
     EventLoop *baseLoop_;
     std::string name_;
     bool started_;
@@ -38,4 +90,16 @@ private:
     int next_; // 轮询的loops_下标
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
+
+    SelectPolicy policy_;
+    LoopSelector selector_;
+    uint64_t random_; // powerOfTwoChoices的随机数状态
+    Timestamp lastSample_;
+    std::vector<int64_t> lastBusy_; // 上次采样时各loop的累计忙碌时间
+    std::vector<int64_t> recentBusy_; // 最近一个采样周期各loop的忙碌时间
+
+    std::vector<int> cpus_;
+    bool pinToCores_;
+    bool numaLocal_;
+    std::vector<int> loopCpus_; // 各subLoop实际绑定的cpu
 };
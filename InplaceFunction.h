@@ -0,0 +1,172 @@
+// 只能移动、带内联存储的函数对象
+#pragma once
+
+#include <cstddef> // size_t nullptr_t max_align_t
+#include <new> // placement new
+#include <type_traits>
+#include <utility> // move forward
+
+/**
+ * 代替std::function<R(Args...)>保存loop任务和channel回调
+ * 可调用对象不超过Capacity字节（例如成员函数指针加一个shared_ptr再加几个字的std::bind）时
+ * 直接构造在对象内部，不分配堆内存；放不下的才退回堆上
+ * 只能移动不能拷贝，所以bind里捕获的shared_ptr、string从投递到执行都不会被复制
+*/
+
+template <typename Signature, size_t Capacity = 64>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+public:
+    InplaceFunction() : ops_(nullptr) {}
+    InplaceFunction(std::nullptr_t) : ops_(nullptr) {}
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, InplaceFunction>::value>::type>
+    InplaceFunction(F &&f)
+        : ops_(nullptr)
+    {
+        using Functor = typename std::decay<F>::type;
+        assign<Functor>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Functor>()>());
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept
+        : ops_(nullptr)
+    {
+        moveFrom(other);
+    }
+
+    InplaceFunction &operator=(InplaceFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceFunction &operator=(std::nullptr_t)
+    {
+        reset();
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction&) = delete;
+    InplaceFunction &operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    R operator()(Args... args) const
+    {
+        return ops_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+private:
+    using Storage = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+    // 按存放方式区分的操作表，每种可调用类型一份
+    struct Ops
+    {
+        R (*invoke)(void *storage, Args&&... args);
+        void (*move)(void *dst, void *src); // 移动到dst并销毁src
+        void (*destroy)(void *storage);
+    };
+
+    template <typename F>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(F) <= sizeof(Storage)
+            && alignof(Storage) % alignof(F) == 0
+            && std::is_nothrow_move_constructible<F>::value;
+    }
+
+    // 直接存放在storage_里
+    template <typename F>
+    struct InlineOps
+    {
+        static R invoke(void *storage, Args&&... args)
+        {
+            return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src)
+        {
+            F *from = static_cast<F*>(src);
+            ::new (dst) F(std::move(*from));
+            from->~F();
+        }
+        static void destroy(void *storage)
+        {
+            static_cast<F*>(storage)->~F();
+        }
+        static const Ops *ops()
+        {
+            static const Ops table = { &invoke, &move, &destroy };
+            return &table;
+        }
+    };
+
+    // 放不下，storage_里只存堆上对象的指针
+    template <typename F>
+    struct HeapOps
+    {
+        static R invoke(void *storage, Args&&... args)
+        {
+            return (**static_cast<F**>(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src)
+        {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        }
+        static void destroy(void *storage)
+        {
+            delete *static_cast<F**>(storage);
+        }
+        static const Ops *ops()
+        {
+            static const Ops table = { &invoke, &move, &destroy };
+            return &table;
+        }
+    };
+
+    template <typename F, typename T>
+    void assign(T &&f, std::true_type)
+    {
+        ::new (static_cast<void*>(&storage_)) F(std::forward<T>(f));
+        ops_ = InlineOps<F>::ops();
+    }
+
+    template <typename F, typename T>
+    void assign(T &&f, std::false_type)
+    {
+        *reinterpret_cast<F**>(&storage_) = new F(std::forward<T>(f));
+        ops_ = HeapOps<F>::ops();
+    }
+
+    void moveFrom(InplaceFunction &other)
+    {
+        if (other.ops_)
+        {
+            ops_ = other.ops_;
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    void reset()
+    {
+        if (ops_)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    const Ops *ops_;
+    mutable Storage storage_; // operator()是const的，和std::function一样允许调用有状态的可调用对象
+};
@@ -0,0 +1,440 @@
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <string.h> // memset
+#include <unistd.h> // close syscall
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+
+namespace
+{
+// 取消请求自身的完成事件用这个标记，收割时直接跳过
+const uint64_t kRemoveTag = ~static_cast<uint64_t>(0);
+// setupRing试探multishot时的请求
+const uint64_t kProbeTag = kRemoveTag - 1;
+
+int sysIoUringSetup(unsigned entries, struct io_uring_params *p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop)
+    , ringFd_(-1)
+    , features_(0)
+    , sqRing_(nullptr)
+    , sqRingSize_(0)
+    , cqRing_(nullptr)
+    , cqRingSize_(0)
+    , sqes_(nullptr)
+    , sqesSize_(0)
+    , sqHead_(nullptr)
+    , sqTail_(nullptr)
+    , sqMask_(0)
+    , sqEntries_(0)
+    , sqArray_(nullptr)
+    , cqHead_(nullptr)
+    , cqTail_(nullptr)
+    , cqMask_(0)
+    , cqes_(nullptr)
+    , pendingSubmit_(0)
+    , round_(0)
+{
+    if (!setupRing())
+    {
+        teardownRing();
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    teardownRing();
+}
+
+bool IoUringPoller::setupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CLAMP;
+    ringFd_ = sysIoUringSetup(kRingEntries, &params);
+    if (ringFd_ < 0)
+    {
+        LOG_ERROR("io_uring_setup error:%d \n", errno);
+        return false;
+    }
+    features_ = params.features;
+    // 等待超时依赖EXT_ARG（5.11），完成队列不丢事件依赖NODROP
+    if (!(features_ & IORING_FEAT_EXT_ARG) || !(features_ & IORING_FEAT_NODROP))
+    {
+        LOG_ERROR("io_uring features 0x%x not supported \n", features_);
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        sqRing_ = nullptr;
+        LOG_ERROR("io_uring mmap sq ring error:%d \n", errno);
+        return false;
+    }
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            cqRing_ = nullptr;
+            LOG_ERROR("io_uring mmap cq ring error:%d \n", errno);
+            return false;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap sqes error:%d \n", errno);
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // 边缘触发依赖multishot poll；旧内核上每次注册都会以EINVAL失败，不如直接用epoll
+    if (!probeMultishot())
+    {
+        LOG_ERROR("io_uring multishot poll not supported \n");
+        return false;
+    }
+    return true;
+}
+
+bool IoUringPoller::probeMultishot()
+{
+    int fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC); // 计数不为0，注册后立即就绪
+    if (fd < 0)
+    {
+        LOG_ERROR("io_uring probe eventfd error:%d \n", errno);
+        return false;
+    }
+
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = kProbeTag;
+
+    bool supported = false;
+    if (enter(pendingSubmit_, 1, IORING_ENTER_GETEVENTS, nullptr) >= 0)
+    {
+        unsigned head = *cqHead_;
+        if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+        {
+            const struct io_uring_cqe &cqe = cqes_[head & cqMask_];
+            // 不支持时以-EINVAL结束；支持时带着F_MORE上报POLLIN
+            supported = cqe.res > 0 && (cqe.flags & IORING_CQE_F_MORE);
+            __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+        }
+    }
+    if (supported)
+    {
+        // 取消还在进行的试探请求，它和取消请求自身的完成事件在reapCompletions里跳过
+        sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = kProbeTag;
+        sqe->user_data = kRemoveTag;
+        enter(pendingSubmit_, 0, 0, nullptr);
+    }
+    ::close(fd);
+    return supported;
+}
+
+void IoUringPoller::teardownRing()
+{
+    if (sqes_)
+    {
+        ::munmap(sqes_, sqesSize_);
+        sqes_ = nullptr;
+    }
+    if (cqRing_ && cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = nullptr;
+    if (sqRing_)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+        sqRing_ = nullptr;
+    }
+    if (ringFd_ >= 0)
+    {
+        ::close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_DEBUG("func=%s => fd total count:%lu \n", __FUNCTION__, channels_.size());
+    ++round_;
+    syncWatches();
+
+    // 完成队列里已经有事件就不再等待
+    const bool ready = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof arg);
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+
+    int ret = enter(pendingSubmit_, ready ? 0 : 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret < 0 && saveErrno != ETIME && saveErrno != EINTR)
+    {
+        errno = saveErrno;
+        LOG_ERROR("IoUringPoller::poll() err! \n");
+    }
+
+    size_t before = activeChannels->size();
+    reapCompletions(activeChannels);
+    if (activeChannels->size() > before)
+    {
+        LOG_DEBUG("%lu events happened \n", activeChannels->size() - before);
+    }
+    else
+    {
+        LOG_DEBUG("%s timeout! \n", __FUNCTION__);
+    }
+    return now;
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    LOG_DEBUG("func=%s => fd=%d events=%d \n", __FUNCTION__, fd, channel->events());
+
+    if (static_cast<size_t>(fd) >= watches_.size())
+    {
+        watches_.resize(fd + 1);
+    }
+    channels_[fd] = channel;
+    watches_[fd].channel = channel;
+    markDirty(fd);
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    channels_.erase(fd);
+
+    LOG_DEBUG("func=%s => fd=%d\n", __FUNCTION__, fd);
+
+    if (static_cast<size_t>(fd) < watches_.size())
+    {
+        Watch &watch = watches_[fd];
+        if (watch.armed)
+        {
+            prepPollRemove(fd, watch);
+        }
+        watch.channel = nullptr;
+    }
+}
+
+void IoUringPoller::markDirty(int fd)
+{
+    Watch &watch = watches_[fd];
+    if (!watch.dirty)
+    {
+        watch.dirty = true;
+        dirtyFds_.push_back(fd);
+    }
+}
+
+void IoUringPoller::syncWatches()
+{
+    for (int fd : dirtyFds_)
+    {
+        Watch &watch = watches_[fd];
+        watch.dirty = false;
+        if (watch.channel == nullptr)
+        {
+            continue;
+        }
+
+        const uint32_t events = static_cast<uint32_t>(watch.channel->events());
+        const bool multishot = watch.channel->isEdgeTriggered();
+        // 关注的事件变了，取消旧的请求再重新注册
+        if (watch.armed && (watch.armedEvents != events || watch.multishot != multishot))
+        {
+            prepPollRemove(fd, watch);
+        }
+        if (!watch.armed && events != 0)
+        {
+            watch.armedEvents = events;
+            watch.multishot = multishot;
+            prepPollAdd(fd, watch);
+        }
+    }
+    dirtyFds_.clear();
+}
+
+struct io_uring_sqe* IoUringPoller::getSqe()
+{
+    unsigned tail = *sqTail_;
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+    {
+        // 提交队列满了，先把已有的提交掉
+        enter(pendingSubmit_, 0, 0, nullptr);
+    }
+    unsigned index = tail & sqMask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++pendingSubmit_;
+    return sqe;
+}
+
+void IoUringPoller::prepPollAdd(int fd, Watch &watch)
+{
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = watch.armedEvents;
+    sqe->len = watch.multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = encode(fd, watch.generation);
+    watch.armed = true;
+}
+
+void IoUringPoller::prepPollRemove(int fd, Watch &watch)
+{
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encode(fd, watch.generation);
+    sqe->user_data = kRemoveTag;
+    watch.armed = false;
+    ++watch.generation; // 被取消的请求可能已经完成，它的事件不能再上报
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const struct io_uring_getevents_arg *arg)
+{
+    int ret = sysIoUringEnter(ringFd_, toSubmit, minComplete, flags, arg, arg ? sizeof *arg : 0);
+    if (ret >= 0)
+    {
+        pendingSubmit_ -= ret;
+    }
+    else if (errno != ETIME && errno != EINTR)
+    {
+        LOG_ERROR("io_uring_enter error:%d \n", errno);
+    }
+    return ret;
+}
+
+void IoUringPoller::reapCompletions(ChannelList *activeChannels)
+{
+    const size_t first = activeChannels->size();
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe &cqe = cqes_[head & cqMask_];
+        if (cqe.user_data == kRemoveTag || cqe.user_data == kProbeTag)
+        {
+            continue;
+        }
+
+        const int fd = static_cast<int>(cqe.user_data >> 32);
+        const uint32_t generation = static_cast<uint32_t>(cqe.user_data);
+        if (static_cast<size_t>(fd) >= watches_.size())
+        {
+            continue;
+        }
+        Watch &watch = watches_[fd];
+        if (watch.channel == nullptr || watch.generation != generation)
+        {
+            continue; // 已经取消或者移除的请求
+        }
+
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            watch.armed = false;
+            // 一次性poll完成了，或者multishot被内核终止（ECANCELED），下一次poll时重新注册；
+            // 其他错误原样重新提交还会失败，等channel下一次updateChannel再注册，不在这里空转
+            if (cqe.res >= 0 || cqe.res == -ECANCELED)
+            {
+                markDirty(fd);
+            }
+        }
+        if (cqe.res < 0)
+        {
+            if (cqe.res != -ECANCELED)
+            {
+                LOG_ERROR("io_uring poll fd=%d err:%d \n", fd, -cqe.res);
+            }
+            continue;
+        }
+
+        // multishot的请求在一批里可能出现多次，事件合并后只上报一次
+        if (watch.reportedRound != round_)
+        {
+            watch.reportedRound = round_;
+            watch.revents = cqe.res;
+            activeChannels->push_back(watch.channel);
+        }
+        else
+        {
+            watch.revents |= cqe.res;
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    for (size_t i = first; i < activeChannels->size(); ++i)
+    {
+        Channel *channel = (*activeChannels)[i];
+        channel->set_revents(watches_[channel->fd()].revents);
+    }
+}
@@ -0,0 +1,99 @@
+// poller的io_uring实现
+#pragma once
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <vector>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+/**
+ * 用io_uring的IORING_OP_POLL_ADD监听fd就绪，接口和EPollPoller一样，TcpConnection/Acceptor不需要改动
+ * updateChannel/removeChannel只记录变化，下一次poll时把所有的注册、取消、重新注册
+ * 和等待合在一次io_uring_enter里提交，不再像epoll_ctl那样每个fd一次系统调用
+ *
+ * 水平触发的channel用一次性poll，事件处理完后在下一次poll时重新注册，没读完的fd会再次立即就绪
+ * 边缘触发的channel用multishot poll，注册一次之后每次唤醒都会上报
+ *
+ * 设置环境变量MUDUO_USE_IOURING启用，内核不支持（早于5.13，没有multishot poll）时退回epoll
+*/
+
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // io_uring是否创建成功，内核太旧或者被seccomp禁用时为false
+    bool valid() const { return ringFd_ >= 0; }
+
+    // EventLoop调用poll，一次io_uring_enter提交积攒的poll请求并等待完成事件
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    // 记录channel关注的事件变化，下一次poll时提交
+    void updateChannel(Channel *channel) override;
+    // 取消channel的poll请求
+    void removeChannel(Channel *channel) override;
+    const char* name() const override { return "io_uring"; }
+
+private:
+    static const unsigned kRingEntries = 256;
+
+    // 每个fd上的poll请求状态，下标是fd
+    struct Watch
+    {
+        Channel *channel = nullptr;
+        uint32_t generation = 0; // 每次取消都加一，旧请求的完成事件据此丢弃
+        uint32_t armedEvents = 0; // 已提交的poll请求关注的事件
+        bool armed = false; // 是否有未完成的poll请求
+        bool multishot = false;
+        bool dirty = false; // 是否在dirtyFds_里等待同步
+        int revents = 0; // 本次poll收集到的事件
+        uint64_t reportedRound = 0; // 最近一次放进activeChannels的poll轮次
+    };
+
+    bool setupRing();
+    // 用一个可读的eventfd试探内核是否支持multishot poll
+    bool probeMultishot();
+    void teardownRing();
+
+    // 取一个空闲的sqe，提交队列满了就先提交一次
+    struct io_uring_sqe* getSqe();
+    void prepPollAdd(int fd, Watch &watch);
+    void prepPollRemove(int fd, Watch &watch);
+    // 把dirtyFds_里的变化转换成sqe
+    void syncWatches();
+    void markDirty(int fd);
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const struct io_uring_getevents_arg *arg);
+    // 收割完成队列，填写活跃的channel
+    void reapCompletions(ChannelList *activeChannels);
+
+    static uint64_t encode(int fd, uint32_t generation)
+    { return (static_cast<uint64_t>(fd) << 32) | generation; }
+
+    int ringFd_;
+    unsigned features_;
+
+    void *sqRing_;
+    size_t sqRingSize_;
+    void *cqRing_;
+    size_t cqRingSize_;
+    struct io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned *sqArray_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe *cqes_;
+
+    unsigned pendingSubmit_; // 已填写但还没提交给内核的sqe个数
+    uint64_t round_; // poll轮次
+
+    std::vector<Watch> watches_;
+    std::vector<int> dirtyFds_;
+};
@@ -0,0 +1,117 @@
+#include "LogFile.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+LogFile::LogFile(const std::string &basename,
+                 off_t rollSize,
+                 int rollInterval)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , rollInterval_(rollInterval)
+    , fp_(nullptr)
+    , writtenBytes_(0)
+    , startOfPeriod_(0)
+    , lastRoll_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile()
+{
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *logline, size_t len)
+{
+    time_t now = ::time(NULL);
+    // 写满或者进入了新的周期就滚动
+    if (writtenBytes_ > rollSize_ || now / rollInterval_ * rollInterval_ != startOfPeriod_)
+    {
+        rollFile();
+    }
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+
+    size_t written = 0;
+    while (written != len)
+    {
+        size_t n = ::fwrite_unlocked(logline + written, 1, len - written, fp_);
+        if (n == 0)
+        {
+            int err = ::ferror(fp_);
+            if (err)
+            {
+                ::fprintf(stderr, "LogFile::append() failed %s\n", ::strerror(err));
+            }
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+}
+
+void LogFile::flush()
+{
+    if (fp_)
+    {
+        ::fflush(fp_);
+    }
+}
+
+bool LogFile::rollFile()
+{
+    time_t now = ::time(NULL);
+    if (now <= lastRoll_ && fp_ != nullptr) // 文件名精确到秒，同一秒内不重复滚动
+    {
+        return false;
+    }
+
+    std::string filename = getLogFileName(basename_, now);
+    FILE *fp = ::fopen(filename.c_str(), "ae"); // e: O_CLOEXEC
+    if (fp == nullptr)
+    {
+        ::fprintf(stderr, "LogFile::rollFile() open %s failed:%d\n", filename.c_str(), errno);
+        return false;
+    }
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+    fp_ = fp;
+    ::setbuffer(fp_, buffer_, sizeof buffer_);
+
+    lastRoll_ = now;
+    startOfPeriod_ = now / rollInterval_ * rollInterval_;
+    writtenBytes_ = 0;
+    return true;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t now)
+{
+    std::string filename(basename);
+
+    char timebuf[32];
+    struct tm tm;
+    ::localtime_r(&now, &tm);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256] = {0};
+    if (::gethostname(hostname, sizeof hostname) != 0)
+    {
+        ::strcpy(hostname, "unknownhost");
+    }
+    filename += hostname;
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", ::getpid());
+    filename += pidbuf;
+    return filename;
+}
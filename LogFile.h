@@ -0,0 +1,41 @@
+// 日志文件，按大小和时间滚动，只由AsyncLogging的后台线程使用，不加锁
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+class LogFile : noncopyable
+{
+public:
+    /**
+     * basename：日志文件名前缀，实际文件名为 basename.20240101-120000.hostname.pid.log
+     * rollSize：单个文件写满rollSize字节后滚动到新文件
+     * rollInterval：每rollInterval秒滚动一次（按整点对齐），默认一天
+    */
+    LogFile(const std::string &basename,
+            off_t rollSize,
+            int rollInterval = 60 * 60 * 24);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    // 关闭当前文件，新建一个文件
+    bool rollFile();
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int rollInterval_;
+
+    FILE *fp_;
+    off_t writtenBytes_; // 当前文件已写入的字节数
+    time_t startOfPeriod_; // 当前文件所属的滚动周期起点
+    time_t lastRoll_; // 上一次滚动的时间，防止一秒内重复创建同名文件
+    char buffer_[64 * 1024]; // FILE的用户态缓冲
+};
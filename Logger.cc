@@ -1,7 +1,65 @@
 #include "Logger.h"
 #include "Timestamp.h"
 
-#include <iostream>
+#include <stdio.h>
+#include <thread>
+
+static void defaultOutput(const char *msg, int len)
+{
+    ::fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush()
+{
+    ::fflush(stdout);
+}
+
+// 默认级别就是编译期下限
+std::atomic_int Logger::logLevel_(MUDUO_LOG_FLOOR);
+
+Logger::Logger()
+    : sink_(new Sink{defaultOutput, defaultFlush})
+    , writers_(0)
+{
+}
+
+Logger::~Logger()
+{
+    delete sink_.load();
+}
+
+void Logger::setOutput(OutputFunc out)
+{
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    publish(new Sink{std::move(out), sink_.load()->flush});
+}
+
+void Logger::setFlush(FlushFunc flush)
+{
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    publish(new Sink{sink_.load()->output, std::move(flush)});
+}
+
+void Logger::resetOutput()
+{
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    publish(new Sink{defaultOutput, defaultFlush});
+}
+
+void Logger::publish(Sink *sink)
+{
+    Sink *old = sink_.exchange(sink);
+    /**
+     * log()先增加writers_再读sink_，这里先换sink_再读writers_，都是seq_cst：
+     * 读到writers_为0时，之后进入的线程一定看到新的sink，旧的没人用了
+     * 换输出很少发生，忙等即可
+    */
+    while (writers_.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+    delete old;
+}
 
 // 获取日志唯一的实例对象
 Logger &Logger::instance()
@@ -10,33 +68,47 @@ Logger &Logger::instance()
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int level)
-{
-    logLevel_ = level;
-}
-
 // 写日志  [日志级别] time : msg
-void Logger::log(std::string msg)
+void Logger::log(int logLevel, const char *msg)
 {
-    switch (logLevel_)
+    const char *level = "";
+    switch (logLevel)
     {
     case INFO:
-        std::cout << "[INFO]";
+        level = "[INFO]";
         break;
     case ERROR:
-        std::cout << "[ERROR]";
+        level = "[ERROR]";
         break;
     case FATAL:
-        std::cout << "[FATAL]";
+        level = "[FATAL]";
         break;
     case DEBUG:
-        std::cout << "[DEBUG]";
+        level = "[DEBUG]";
         break;
     default:
         break;
     }
 
-    // 打印时间和msg
-    std::cout << Timestamp::now().toString() << " : " << msg << std::endl;
-}
\ No newline at end of file
+    // 先在栈上拼好整行，输出函数只调用一次，异步后端只需要一次拷贝
+    // 日志时间只精确到秒，用粗粒度时钟，秒内的格式化结果每个线程都有缓存
+    char timebuf[32];
+    Timestamp::nowCoarse().formatTo(timebuf, sizeof timebuf);
+
+    char line[1200];
+    int len = snprintf(line, sizeof line, "%s%s : %s\n", level, timebuf, msg);
+    if (len >= static_cast<int>(sizeof line))
+    {
+        len = sizeof line - 1;
+        line[len - 1] = '\n';
+    }
+    ++writers_;
+    Sink *sink = sink_.load();
+    sink->output(line, len);
+
+    if (logLevel == FATAL) // FATAL之后进程就退出了，先把缓冲的日志刷出去
+    {
+        sink->flush();
+    }
+    --writers_;
+}
@@ -2,63 +2,79 @@
 #pragma once
 
 #include <string> // 不同的include比如自己的和库里的 做区别
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "noncopyable.h"
 
-// 定义4种日志级别的宏，用户只需要专注写日志，其余由宏
-// 用户使用：LOG_INFO("%s %d", arg1, arg2)
-#define LOG_INFO(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) // 使用do while有很多原因，最主要是把它作为一个独立单元，避免与调用处上下文混淆，并且大多数系统都可以识别无效的while
+// 编译期的日志级别下限，低于它的日志语句整个被预处理掉，参数也不会求值
+// 可以在编译选项里用 -DMUDUO_LOG_FLOOR=2 只保留ERROR和FATAL
+#define MUDUO_LOG_LEVEL_DEBUG 0
+#define MUDUO_LOG_LEVEL_INFO 1
+#define MUDUO_LOG_LEVEL_ERROR 2
+#define MUDUO_LOG_LEVEL_FATAL 3
 
-#define LOG_ERROR(logmsgFormat, ...) \
+#ifndef MUDUO_LOG_FLOOR
+#ifdef MUDEBUG // 由于调试信息太多，影响效率，设置debug开关
+#define MUDUO_LOG_FLOOR MUDUO_LOG_LEVEL_DEBUG
+#else
+#define MUDUO_LOG_FLOOR MUDUO_LOG_LEVEL_INFO
+#endif
+#endif
+
+// 运行期先用原子变量比较级别，不需要输出的日志不做格式化
+#define MUDUO_LOG_IMPL(level, logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
+        if (Logger::logLevel() <= level) \
+        { \
+            char buf[1024]; /* snprintf保证以'\0'结尾，不需要清零 */ \
+            snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__); \
+            Logger::instance().log(level, buf); \
+        } \
+    } while(0)
+
+// 定义4种日志级别的宏，用户只需要专注写日志，其余由宏
+// 用户使用：LOG_INFO("%s %d", arg1, arg2)
+// 使用do while有很多原因，最主要是把它作为一个独立单元，避免与调用处上下文混淆，并且大多数系统都可以识别无效的while
+#if MUDUO_LOG_FLOOR <= MUDUO_LOG_LEVEL_INFO
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(logmsgFormat, ...) do {} while(0)
+#endif
 
+#if MUDUO_LOG_FLOOR <= MUDUO_LOG_LEVEL_ERROR
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logmsgFormat, ...) do {} while(0)
+#endif
+
+// FATAL不受级别控制，总是输出并退出
 #define LOG_FATAL(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        char buf[1024]; \
+        snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__); \
+        Logger::instance().log(FATAL, buf); \
         exit(-1); \
     } while(0) 
 
-#ifdef MUDEBUG // 由于调试信息太多，影响效率，设置debug开关
-#define LOG_DEBUG(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
+#if MUDUO_LOG_FLOOR <= MUDUO_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
 #else
-    #define LOG_DEBUG(logmsgFormat, ...) // 空
+#define LOG_DEBUG(logmsgFormat, ...) do {} while(0) // 空
 #endif
 
-// 定义日志的级别  INFO  ERROR  FATAL  DEBUG 
+// 定义日志的级别  DEBUG  INFO  ERROR  FATAL，按严重程度递增，和上面的编译期宏一一对应
 enum LogLevel
 {
-    INFO,  // 普通信息
-    ERROR, // 错误信息
-    FATAL, // core信息 致命的奔溃错误信息
-    DEBUG, // 调试信息
+    DEBUG = MUDUO_LOG_LEVEL_DEBUG, // 调试信息
+    INFO = MUDUO_LOG_LEVEL_INFO,  // 普通信息
+    ERROR = MUDUO_LOG_LEVEL_ERROR, // 错误信息
+    FATAL = MUDUO_LOG_LEVEL_FATAL, // core信息 致命的奔溃错误信息
 };
 
 // 输出一个日志类
@@ -67,11 +83,36 @@ class Logger : noncopyable
 public:
     // 获取日志唯一的实例对象
     static Logger& instance(); // 返回引用因为使用.成员方便，static唯一
-    // 设置日志级别
-    void setLogLevel(int level);
-    // 写日志
-    void log(std::string msg);
+    // 设置输出日志的最低级别，运行期可以随时调整，线程安全
+    static void setLogLevel(int level) { logLevel_.store(level, std::memory_order_relaxed); }
+    static int logLevel() { return logLevel_.load(std::memory_order_relaxed); }
+    // 写日志，级别由调用者传入，不再修改共享状态
+    void log(int level, const char *msg);
+
+    // 日志输出目的地，默认写stdout；可以换成AsyncLogging::append把日志交给后台线程写文件，
+    // 这时刷新也要换成AsyncLogging::flush，否则FATAL退出时缓冲里的日志会丢失，见AsyncLogging::attachToLogger
+    // 任何时候都可以更换，返回时已经没有线程还在使用旧的输出，旧输出引用的对象可以安全销毁
+    using OutputFunc = std::function<void(const char *msg, int len)>;
+    using FlushFunc = std::function<void()>;
+    void setOutput(OutputFunc out);
+    void setFlush(FlushFunc flush);
+    // 恢复默认的stdout输出和刷新
+    void resetOutput();
 private:
-    int logLevel_; // 末尾的下划线区分系统变量，同时区分成员函数和成员变量
-    // Logger() {};
+    // 输出和刷新一起发布，log()读一次指针就拿到一致的一对
+    struct Sink
+    {
+        OutputFunc output;
+        FlushFunc flush;
+    };
+
+    Logger();
+    ~Logger();
+
+    void publish(Sink *sink); // 换上新的Sink，等正在使用旧Sink的线程都写完再释放它
+
+    static std::atomic_int logLevel_; // 末尾的下划线区分系统变量，同时区分成员函数和成员变量
+    std::mutex sinkMutex_; // 串行化对sink_的修改，log()不加锁
+    std::atomic<Sink*> sink_;
+    std::atomic_int writers_; // 正在使用sink_的线程数
 };
@@ -0,0 +1,65 @@
+#include "LoopMetrics.h"
+
+#include <algorithm>
+#include <math.h>
+
+const int LoopMetrics::kLagBuckets;
+
+void LoopMetrics::merge(const LoopMetrics &other)
+{
+    polls += other.polls;
+    pollWaitMicros += other.pollWaitMicros;
+    busyMicros += other.busyMicros;
+    eventsDispatched += other.eventsDispatched;
+    maxEventsPerPoll = std::max(maxEventsPerPoll, other.maxEventsPerPoll);
+    functorsRun += other.functorsRun;
+    functorDrainMicros += other.functorDrainMicros;
+    lastFunctorBatch += other.lastFunctorBatch;
+    maxFunctorBatch = std::max(maxFunctorBatch, other.maxFunctorBatch);
+    activeConnections += other.activeConnections;
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+    bufferGrowths += other.bufferGrowths;
+    highWaterMarkHits += other.highWaterMarkHits;
+    slowCallbacks += other.slowCallbacks;
+    for (int i = 0; i < kLagBuckets; ++i)
+    {
+        lagBuckets[i] += other.lagBuckets[i];
+    }
+    loops += other.loops;
+}
+
+int64_t LoopMetrics::lagPercentileMicros(double percent) const
+{
+    int64_t total = 0;
+    for (int i = 0; i < kLagBuckets; ++i)
+    {
+        total += lagBuckets[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    int64_t rank = std::max<int64_t>(1, static_cast<int64_t>(ceil(total * percent / 100.0)));
+    int64_t seen = 0;
+    for (int i = 0; i < kLagBuckets - 1; ++i)
+    {
+        seen += lagBuckets[i];
+        if (seen >= rank)
+        {
+            return int64_t(1) << (i + 1);
+        }
+    }
+    return int64_t(1) << kLagBuckets; // 最后一个桶没有上界，返回的只是下限的两倍
+}
+
+int LoopMetrics::lagBucket(int64_t micros)
+{
+    int bucket = 0;
+    while (micros > 1 && bucket < kLagBuckets - 1)
+    {
+        micros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
@@ -0,0 +1,65 @@
+// EventLoop的运行统计
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * 某一时刻一个（或合并后的多个）loop的统计值
+ * 累计值从loop开始运行计起，两次快照相减就是这段时间内的量
+*/
+struct LoopMetrics
+{
+    int64_t polls = 0; // poll（epoll_wait/io_uring_enter）的次数
+    int64_t pollWaitMicros = 0; // 阻塞在poll里的时间
+    int64_t busyMicros = 0; // 从poll返回到处理完事件和回调的时间
+    int64_t eventsDispatched = 0; // 分发给channel的事件数
+    int64_t maxEventsPerPoll = 0; // 一次poll返回的最多活跃channel数
+    int64_t functorsRun = 0; // 执行的queueInLoop回调数
+    int64_t functorDrainMicros = 0; // 执行这些回调花的时间
+    int64_t lastFunctorBatch = 0; // 最近一次从队列取出的回调数，即取出时队列的深度
+    int64_t maxFunctorBatch = 0;
+    int64_t activeConnections = 0; // 当前分配到loop上的连接数
+    int64_t bytesRead = 0;
+    int64_t bytesWritten = 0;
+    int64_t bufferGrowths = 0; // Buffer扩容（重新分配内存）的次数
+    int64_t highWaterMarkHits = 0; // 待发送数据越过高水位的次数
+    int64_t slowCallbacks = 0; // 超过EventLoop::setSlowCallbackThreshold阈值的回调（和整轮循环）次数
+
+    /**
+     * 循环延迟的直方图：每轮循环从poll返回到处理完所有事件和回调的时间，
+     * 即这一轮里其他连接的事件最多被推迟多久
+     * 第i个桶统计[2^i, 2^(i+1))微秒，第0个桶包括不到1微秒的，最后一个桶包括所有更长的
+    */
+    static const int kLagBuckets = 24;
+    int64_t lagBuckets[kLagBuckets] = {};
+
+    int loops = 0; // 合并了几个loop的统计
+
+    double eventsPerPoll() const { return polls > 0 ? static_cast<double>(eventsDispatched) / polls : 0.0; }
+    // 循环延迟的百分位（percent取0~100），返回所在桶的上界，没有数据时返回0
+    int64_t lagPercentileMicros(double percent) const;
+    // micros落在哪个桶
+    static int lagBucket(int64_t micros);
+
+    // 合并另一个loop的统计：计数相加，最大值取较大的
+    void merge(const LoopMetrics &other);
+};
+
+/**
+ * loop线程写、任意线程读的计数器
+ * 只有一个写者，用load+store代替原子加，不产生lock前缀的指令
+*/
+class LoopCounter
+{
+public:
+    LoopCounter() : value_(0) {}
+
+    void add(int64_t delta) { value_.store(value_.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed); }
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void setMax(int64_t value) { if (value > get()) set(value); }
+    int64_t get() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_;
+};
@@ -0,0 +1,209 @@
+// 多生产者单消费者的无锁队列
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <utility> // move
+
+/**
+ * 基于链表的MPSC队列（Vyukov），用于其他线程向loop线程投递回调
+ * push：任意线程调用，一次原子exchange，不加锁
+ * pop：只能由唯一的消费者线程调用
+ *
+ * 生产者刚exchange完head_、还没链接next的瞬间，pop会暂时看不到这个及其之后的元素，
+ * 调用方需要在push完成之后再决定是否唤醒消费者，见EventLoop::queueInLoop
+ *
+ * 节点复用，稳定运行时push不分配内存：pop释放的节点先进本线程的缓存，满了再压进同类型队列共享的
+ * 无锁栈，共享栈也满了就直接delete；push先用本线程缓存，空了把共享栈整条取走。
+ * 共享栈只有压栈和整条取走，没有ABA问题；两级缓存都有上限，突发之后多出来的节点会释放掉
+ * 复用的节点里保留的是被移走之后的T，T移走后应当不再持有资源（例如InplaceFunction）
+*/
+
+// 假定的缓存行大小，用于把不同线程频繁写的字段隔开
+const int kCacheLineSize = 64;
+
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue()
+        : head_(new Node)
+        , tail_(head_.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value))
+        {
+        }
+        delete tail_; // 剩下的哨兵节点
+    }
+
+    // 任意线程调用
+    void push(T value)
+    {
+        Node *node = allocNode();
+        node->value = std::move(value);
+        // 先抢占队尾，再把前一个节点链接过来
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 只能在消费者线程调用，队列为空时返回false
+    bool pop(T &value)
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+        {
+            return false;
+        }
+        // next成为新的哨兵，它的值被移走
+        value = std::move(next->value);
+        tail_ = next;
+        freeNode(tail);
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        Node() : next(nullptr) {}
+
+        std::atomic<Node*> next; // 在队列里链接下一个元素，在缓存里链接下一个空闲节点
+        T value;
+    };
+
+    // 每个线程最多缓存的空闲节点数，多出来的交给共享栈；共享栈的上限相同
+    static const size_t kMaxCachedNodes = 256;
+
+    struct NodeCache
+    {
+        Node *head = nullptr;
+        size_t size = 0;
+
+        ~NodeCache()
+        {
+            while (head)
+            {
+                Node *next = head->next.load(std::memory_order_relaxed);
+                delete head;
+                head = next;
+            }
+            cacheDestroyed_ = true; // 线程退出之后（比如全局对象析构时）释放的节点直接delete
+        }
+    };
+
+    static NodeCache &localCache()
+    {
+        static thread_local NodeCache cache;
+        return cache;
+    }
+
+    // 所有线程共享的空闲节点栈，进程退出时不回收，避免和静态对象的析构顺序纠缠
+    struct SharedFree
+    {
+        SharedFree() : head(nullptr), size(0) {}
+
+        std::atomic<Node*> head;
+        std::atomic<long> size; // 近似的节点数，压栈和取走不是同一个原子操作，并发时会短暂偏差
+    };
+
+    static SharedFree &sharedFree()
+    {
+        static SharedFree *shared = new SharedFree;
+        return *shared;
+    }
+
+    static Node *allocNode()
+    {
+        if (cacheDestroyed_)
+        {
+            return new Node;
+        }
+        NodeCache &cache = localCache();
+        if (cache.head == nullptr)
+        {
+            // 整条取走，超过本线程缓存上限的部分（计数偏差带来的）直接释放
+            SharedFree &shared = sharedFree();
+            Node *chain = shared.head.exchange(nullptr, std::memory_order_acquire);
+            if (chain == nullptr)
+            {
+                return new Node;
+            }
+            long taken = 0;
+            Node *last = nullptr;
+            for (Node *n = chain; n; n = n->next.load(std::memory_order_relaxed))
+            {
+                if (cache.size == kMaxCachedNodes)
+                {
+                    last->next.store(nullptr, std::memory_order_relaxed);
+                    while (n)
+                    {
+                        Node *next = n->next.load(std::memory_order_relaxed);
+                        delete n;
+                        n = next;
+                        ++taken;
+                    }
+                    break;
+                }
+                last = n;
+                ++cache.size;
+                ++taken;
+            }
+            shared.size.fetch_sub(taken, std::memory_order_relaxed);
+            cache.head = chain;
+        }
+        Node *node = cache.head;
+        cache.head = node->next.load(std::memory_order_relaxed);
+        --cache.size;
+        node->next.store(nullptr, std::memory_order_relaxed);
+        return node;
+    }
+
+    static void freeNode(Node *node)
+    {
+        if (cacheDestroyed_)
+        {
+            delete node;
+            return;
+        }
+        NodeCache &cache = localCache();
+        if (cache.size < kMaxCachedNodes)
+        {
+            node->next.store(cache.head, std::memory_order_relaxed);
+            cache.head = node;
+            ++cache.size;
+            return;
+        }
+        SharedFree &shared = sharedFree();
+        if (shared.size.load(std::memory_order_relaxed) >= static_cast<long>(kMaxCachedNodes))
+        {
+            delete node;
+            return;
+        }
+        Node *head = shared.head.load(std::memory_order_relaxed);
+        do
+        {
+            node->next.store(head, std::memory_order_relaxed);
+        } while (!shared.head.compare_exchange_weak(head, node,
+                    std::memory_order_release, std::memory_order_relaxed));
+        shared.size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static __thread bool cacheDestroyed_;
+
+    // 生产者写head_，消费者写tail_，分开在不同的缓存行上
+    char padBefore_[kCacheLineSize];
+    std::atomic<Node*> head_;
+    char padHead_[kCacheLineSize - sizeof(std::atomic<Node*>)];
+    Node *tail_;
+    char padTail_[kCacheLineSize - sizeof(Node*)];
+};
+
+template <typename T>
+__thread bool MpscQueue<T>::cacheDestroyed_ = false;
@@ -0,0 +1,125 @@
+#include "ObjectPool.h"
+#include "CurrentThread.h"
+
+#include <stdlib.h>
+
+ObjectPool::ObjectPool(size_t maxFreeSlots)
+    : ownerTid_(CurrentThread::tid())
+    , maxFreeSlots_(maxFreeSlots)
+    , slotSize_(0)
+    , freeList_(nullptr)
+    , freeCount_(0)
+    , inUse_(0)
+    , remoteFree_(nullptr)
+{
+}
+
+ObjectPool::~ObjectPool()
+{
+    // 析构时已经没有分配器引用这个池，所有槽位都归还了
+    reclaimRemote();
+    while (freeList_)
+    {
+        FreeSlot *next = freeList_->next;
+        ::free(freeList_);
+        freeList_ = next;
+    }
+}
+
+bool ObjectPool::inOwnerThread() const
+{
+    return CurrentThread::tid() == ownerTid_;
+}
+
+void *ObjectPool::allocate(size_t size)
+{
+    size_t slotSize = slotSize_.load(std::memory_order_relaxed);
+    if ((slotSize != 0 && slotSize != size) || size < sizeof(FreeSlot))
+    {
+        return ::malloc(size);
+    }
+    if (!inOwnerThread())
+    {
+        // 不动所属线程的空闲链表；同样大小的块归还时照样进池
+        void *p = ::malloc(size);
+        if (p && slotSize != 0)
+        {
+            inUse_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return p;
+    }
+    if (slotSize == 0)
+    {
+        slotSize_.store(size, std::memory_order_relaxed);
+    }
+
+    if (freeList_ == nullptr)
+    {
+        reclaimRemote();
+    }
+    void *slot;
+    if (freeList_)
+    {
+        slot = freeList_;
+        freeList_ = freeList_->next;
+        freeCount_.store(freeCount_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+    else
+    {
+        slot = ::malloc(size);
+        if (slot == nullptr)
+        {
+            return nullptr;
+        }
+    }
+    inUse_.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+void ObjectPool::deallocate(void *p, size_t size)
+{
+    if (size != slotSize_.load(std::memory_order_relaxed))
+    {
+        ::free(p);
+        return;
+    }
+    // 其他线程malloc出来的同样大小的块也收进池里，之后由所属线程复用
+    inUse_.fetch_sub(1, std::memory_order_relaxed);
+    FreeSlot *slot = static_cast<FreeSlot*>(p);
+    if (inOwnerThread())
+    {
+        pushLocal(slot);
+        return;
+    }
+    // 只有压栈和整条取走两种操作，没有ABA问题
+    FreeSlot *head = remoteFree_.load(std::memory_order_relaxed);
+    do
+    {
+        slot->next = head;
+    } while (!remoteFree_.compare_exchange_weak(head, slot,
+                std::memory_order_release, std::memory_order_relaxed));
+}
+
+void ObjectPool::pushLocal(FreeSlot *slot)
+{
+    size_t freeCount = freeCount_.load(std::memory_order_relaxed);
+    if (freeCount >= maxFreeSlots_)
+    {
+        ::free(slot);
+        return;
+    }
+    slot->next = freeList_;
+    freeList_ = slot;
+    freeCount_.store(freeCount + 1, std::memory_order_relaxed);
+}
+
+void ObjectPool::reclaimRemote()
+{
+    FreeSlot *slot = remoteFree_.exchange(nullptr, std::memory_order_acquire);
+    while (slot)
+    {
+        FreeSlot *next = slot->next;
+        pushLocal(slot);
+        slot = next;
+    }
+}
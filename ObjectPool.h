@@ -0,0 +1,109 @@
+// 每个EventLoop一个的对象槽位池，连接对象（连同shared_ptr控制块）从这里分配
+#pragma once
+
+#include "noncopyable.h"
+#include "MpscQueue.h" // kCacheLineSize
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * 固定大小的槽位池，槽位大小由第一次分配决定（std::allocate_shared的节点大小）
+ * 所属loop线程分配和归还都走本地空闲链表，不加锁
+ * 连接最后一个shared_ptr可能在其他线程释放：那时槽位无锁地压进remoteFree_，
+ * 所属线程下次分配时整条取回，槽位总是回到创建它的loop上复用
+ * 大小不符、或者在其他线程分配的，直接走malloc/free
+*/
+class ObjectPool : noncopyable
+{
+public:
+    explicit ObjectPool(size_t maxFreeSlots = 1024);
+    ~ObjectPool();
+
+    void *allocate(size_t size);
+    // 任意线程调用
+    void deallocate(void *p, size_t size);
+
+    size_t slotSize() const { return slotSize_.load(std::memory_order_relaxed); }
+    // 借出未归还的槽位数
+    size_t inUseSlots() const { return inUse_.load(std::memory_order_relaxed); }
+    // 所属线程空闲链表里的槽位数（不含其他线程归还、还没取回的）
+    size_t freeSlots() const { return freeCount_.load(std::memory_order_relaxed); }
+
+private:
+    struct FreeSlot
+    {
+        FreeSlot *next;
+    };
+
+    bool inOwnerThread() const;
+    void pushLocal(FreeSlot *slot);
+    // 取回其他线程归还的槽位
+    void reclaimRemote();
+
+    const pid_t ownerTid_; // 在loop线程里构造
+    const size_t maxFreeSlots_;
+    std::atomic<size_t> slotSize_; // 0表示还没确定
+    FreeSlot *freeList_;
+    std::atomic<size_t> freeCount_;
+    std::atomic<size_t> inUse_;
+
+    // 其他线程只写这里，和上面所属线程的字段分开在不同的缓存行
+    char padRemote_[kCacheLineSize];
+    std::atomic<FreeSlot*> remoteFree_;
+};
+
+/**
+ * 把ObjectPool包装成标准分配器，配合std::allocate_shared使用：
+ * TcpConnection、它的Socket、Channel（成员对象）和shared_ptr控制块是一次分配、连续的一块内存
+ * 分配器持有池的shared_ptr，loop先退出、连接后释放也能安全归还
+*/
+template <typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(std::shared_ptr<ObjectPool> pool) : pool_(std::move(pool)) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool_) {}
+
+    T *allocate(size_t n)
+    {
+        if (n == 1)
+        {
+            void *p = pool_->allocate(sizeof(T));
+            if (p == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(p);
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        if (n == 1)
+        {
+            pool_->deallocate(p, sizeof(T));
+        }
+        else
+        {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &other) const { return pool_ == other.pool_; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &other) const { return pool_ != other.pool_; }
+
+private:
+    template <typename U> friend class PoolAllocator;
+
+    std::shared_ptr<ObjectPool> pool_;
+};
@@ -24,6 +24,8 @@ public:
     virtual void updateChannel(Channel *channel) = 0;
     // 从poller中删除channel
     virtual void removeChannel(Channel *channel) = 0;
+    // 实现的名字，比如"epoll"，用于日志和压测报告
+    virtual const char* name() const = 0;
 
     // 判断poller是否有目标channel
     bool hasChannel(Channel *channel) const;
@@ -3,6 +3,7 @@
 #include "InetAddress.h"
 
 #include <unistd.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <strings.h>
@@ -74,3 +75,11 @@ void Socket::setKeepAlive(bool on)
     int optVal = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optVal, sizeof optVal);
 }
+
+void Socket::setIncomingCpu(int cpu)
+{
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof cpu) < 0)
+    {
+        LOG_ERROR("setIncomingCpu error:%d \n", errno);
+    }
+}
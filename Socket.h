@@ -23,6 +23,8 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on); // 启动TCP Sock的保活机制
+    // SO_INCOMING_CPU，SO_REUSEPORT组里优先把在该cpu上收到的连接交给这个监听socket
+    void setIncomingCpu(int cpu);
 private:
     const int sockfd_;
 };
@@ -0,0 +1,145 @@
+#include "TcpClient.h"
+#include "Logger.h"
+#include "Connector.h"
+#include "ObjectPool.h"
+
+#include <functional>
+#include <strings.h>
+#include <sys/socket.h>
+
+static EventLoop *CheckLoopNotNull(EventLoop *loop)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d TcpClient Loop is null! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+static InetAddress getAddr(int sockfd, bool peer)
+{
+    sockaddr_in addr;
+    ::bzero(&addr, sizeof addr);
+    socklen_t addrlen = sizeof addr;
+    int ret = peer ? ::getpeername(sockfd, (sockaddr*)&addr, &addrlen)
+                   : ::getsockname(sockfd, (sockaddr*)&addr, &addrlen);
+    if (ret < 0)
+    {
+        LOG_ERROR("TcpClient get %s address of fd=%d failed \n", peer ? "peer" : "local", sockfd);
+    }
+    return InetAddress(addr);
+}
+
+// TcpClient析构后连接由它自己关闭，关闭时只需要在loop里销毁
+static void removeConnectionAfterClient(EventLoop *loop, const TcpConnectionPtr &conn)
+{
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn), &TcpConnection::describe, conn.get());
+}
+
+TcpClient::TcpClient(EventLoop *loop,
+                     const InetAddress &serverAddr,
+                     const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop))
+    , connector_(std::make_shared<Connector>(loop, serverAddr))
+    , name_(nameArg)
+    , connNamePrefix_(std::make_shared<const std::string>(nameArg + "-" + serverAddr.toIpPort() + "#"))
+    , retry_(false)
+    , connect_(false)
+    , tcpNoDelay_(false)
+    , nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+}
+
+TcpClient::~TcpClient()
+{
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        unique = connection_.use_count() == 1;
+        conn = connection_;
+    }
+    if (conn)
+    {
+        // 连接可能比TcpClient活得久，关闭时不能再回调this
+        CloseCallback cb = std::bind(&removeConnectionAfterClient, loop_, std::placeholders::_1);
+        loop_->runInLoop(std::bind(&TcpConnection::setCloseCallback, conn, cb));
+        if (unique)
+        {
+            conn->forceClose(); // 用户没有持有这个连接，没人会再关闭它
+        }
+    }
+    else
+    {
+        connector_->stop();
+    }
+}
+
+void TcpClient::connect()
+{
+    LOG_INFO("TcpClient::connect [%s] - connecting to %s \n",
+        name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect()
+{
+    connect_ = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (connection_)
+    {
+        connection_->shutdown();
+    }
+}
+
+void TcpClient::stop()
+{
+    connect_ = false;
+    connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd)
+{
+    InetAddress peerAddr(getAddr(sockfd, true));
+    InetAddress localAddr(getAddr(sockfd, false));
+
+    // 和TcpServer一样，连接和控制块一次分配，槽位来自loop的对象池
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(
+                            PoolAllocator<TcpConnection>(loop_->objectPool()),
+                            loop_,
+                            nextConnId_++,
+                            connNamePrefix_,
+                            sockfd,
+                            localAddr,
+                            peerAddr);
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setTcpNoDelay(tcpNoDelay_);
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn), &TcpConnection::describe, conn.get());
+    if (retry_ && connect_)
+    {
+        LOG_INFO("TcpClient::removeConnection [%s] - reconnecting to %s \n",
+            name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
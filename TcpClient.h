@@ -0,0 +1,78 @@
+// 对外客户端编程，和TcpServer一样用TcpConnection收发数据
+#pragma once
+
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "TcpConnection.h"
+#include "Buffer.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class Connector;
+
+/**
+ * 一个TcpClient管理到serverAddr的一条连接，连接在loop上收发数据
+ * enableRetry之后连接断开会自动重新连接，连接失败按Connector的指数退避重试
+*/
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop,
+              const InetAddress &serverAddr,
+              const std::string &nameArg);
+    ~TcpClient();
+
+    // 发起连接，任意线程调用
+    void connect();
+    // 关闭已建立的连接（等发送缓冲发完）
+    void disconnect();
+    // 停止正在进行的连接和重试
+    void stop();
+
+    TcpConnectionPtr connection() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+
+    bool retry() const { return retry_; }
+    // 连接断开后自动重连
+    void enableRetry() { retry_ = true; }
+
+    // 回调在loop线程执行，需要在connect之前设置
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    void setTcpNoDelay(bool on) { tcpNoDelay_ = on; }
+
+private:
+    // Connector连接成功后在loop线程调用
+    void newConnection(int sockfd);
+    // 在loop线程执行
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    std::shared_ptr<Connector> connector_;
+    const std::string name_;
+    const std::shared_ptr<const std::string> connNamePrefix_; // 连接名字的公共前缀 name-ip:port#
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    bool tcpNoDelay_;
+    uint64_t nextConnId_; // 只在loop线程使用
+
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_; // 其他线程通过connection()读取，加锁
+};
@@ -10,9 +10,14 @@
 #include <sys/socket.h>
 #include <strings.h>
 #include <netinet/tcp.h>
-#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <algorithm>
 #include <string>
 
+// 接收缓冲空闲多久之后释放内存
+static const double kBufferIdleSeconds = 5.0;
+
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
     if (loop == nullptr)
@@ -27,34 +32,79 @@ TcpConnection::TcpConnection(EventLoop *loop,
                              int sockfd,
                              const InetAddress &localAddr,
                              const InetAddress &peerAddr)
+    : TcpConnection(loop, 0, nullptr, sockfd, localAddr, peerAddr)
+{
+    name_ = nameArg;
+}
+
+TcpConnection::TcpConnection(EventLoop *loop,
+                             uint64_t id,
+                             std::shared_ptr<const std::string> namePrefix,
+                             int sockfd,
+                             const InetAddress &localAddr,
+                             const InetAddress &peerAddr)
     : loop_(CheckLoopNotNull(loop))
-	, name_(nameArg)
+	, id_(id)
+	, namePrefix_(std::move(namePrefix))
 	, state_(kConnecting)
 	, reading_(true)
-	, socket_(new Socket(sockfd))
-	, channel_(new Channel(loop, sockfd))
+	, socket_(sockfd)
+	, channel_(loop, sockfd)
 	, localAddr_(localAddr)
 	, peerAddr_(peerAddr)
 	, highWaterMark_(64 * 1024 * 1024) // 64M
+	, idleTimeout_(0.0)
+	, readBudget_(0)
+	, edgeTriggered_(false)
+	, inputBuffer_(0) // 空闲连接不持有缓冲内存，收到数据时再按需分配
+	, outputBuffer_(loop->bufferPool())
+	, pendingBytes_(0)
 {
     // 设置channel的回调，poller给channel通知感兴趣的事件发生，channel就会执行回调
-    channel_->setReadCallback(
+    channel_.setReadCallback(
         std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
-    channel_->setWriteCallback(
+    channel_.setWriteCallback(
         std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(
+    channel_.setCloseCallback(
         std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(
+    channel_.setErrorCallback(
         std::bind(&TcpConnection::handleError, this));
+    channel_.setDescription(&TcpConnection::describe, this);
+    // 两个超时都走handleClose关闭连接；连接关闭和销毁时会从时间轮摘除，所以可以直接绑定this
+    idleEntry_.setCallback(std::bind(&TcpConnection::handleTimeout, this));
+    readDeadlineEntry_.setCallback(std::bind(&TcpConnection::handleTimeout, this));
+    bufferIdleEntry_.setCallback(std::bind(&TcpConnection::handleBufferIdle, this));
+    idleEntry_.setDescription(&TcpConnection::describe, this);
+    readDeadlineEntry_.setDescription(&TcpConnection::describe, this);
+    bufferIdleEntry_.setDescription(&TcpConnection::describe, this);
 
-    LOG_INFO("TcpConnection::ctor[%s] at fd=%d \n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);
+    LOG_INFO("TcpConnection::ctor[%lu] at fd=%d \n", static_cast<unsigned long>(id_), sockfd);
+    socket_.setKeepAlive(true);
+    // 分配时就计入loop的负载，连接还没建立也能影响下一次的选择
+    loop_->addActiveConnections(1);
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d \n",
-             name_.c_str(), channel_->fd(), (int)state_);
+    LOG_INFO("TcpConnection::dtor[%lu] at fd=%d state=%d \n",
+             static_cast<unsigned long>(id_), channel_.fd(), (int)state_);
+}
+
+std::string TcpConnection::describe(const void *conn)
+{
+    return static_cast<const TcpConnection*>(conn)->name();
+}
+
+const std::string& TcpConnection::name() const
+{
+    // 大多数连接从不需要名字，只在日志或用户用到时才分配字符串
+    std::call_once(nameOnce_, [this]() {
+        if (namePrefix_)
+        {
+            name_ = *namePrefix_ + std::to_string(id_);
+        }
+    });
+    return name_;
 }
 
 void TcpConnection::send(const std::string &buf)
@@ -66,23 +116,124 @@ void TcpConnection::send(const std::string &buf)
             sendInLoop(buf.c_str(), buf.size());
         }
         else
+        {
+            // 跨线程时buf在执行前可能已经析构，拷贝一份交给loop线程
+            std::vector<std::string> pieces(1, buf);
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendPiecesInLoop,
+                shared_from_this(),
+                std::move(pieces)
+			), &TcpConnection::describe, this);
+        }
+    }
+}
+
+void TcpConnection::sendv(const struct iovec *slices, int count)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendvInLoop(slices, count);
+        }
+        else
+        {
+            // slices指向调用者的内存，跨线程时先拷贝成独立的片段，但不拼接
+            std::vector<std::string> pieces;
+            pieces.reserve(count);
+            for (int i = 0; i < count; ++i)
+            {
+                pieces.emplace_back(static_cast<const char*>(slices[i].iov_base), slices[i].iov_len);
+            }
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendPiecesInLoop,
+                shared_from_this(),
+                std::move(pieces)
+            ), &TcpConnection::describe, this);
+        }
+    }
+}
+
+void TcpConnection::sendv(std::vector<std::string> pieces)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendPiecesInLoop(pieces);
+        }
+        else
         {
             loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop,
-                this,
-                buf.c_str(),
-                buf.size()
-			));
+                &TcpConnection::sendPiecesInLoop,
+                shared_from_this(),
+                std::move(pieces)
+            ), &TcpConnection::describe, this);
         }
     }
 }
 
 void TcpConnection::sendInLoop(const void *data, size_t len)
 {
-    ssize_t nwrote = 0; // 调用write后已发送的数据长度
-    size_t remaining = len; // 待发送的数据长度
-    bool faultError = false; // 出现错误
+    struct iovec vec;
+    vec.iov_base = const_cast<void*>(data);
+    vec.iov_len = len;
+    sendvInLoop(&vec, 1);
+}
+
+size_t TcpConnection::writeDirect(const struct iovec *vec, int count, size_t total, bool *faultError)
+{
+    *faultError = false;
+    // channel_不在发送数据，而且缓冲没有之前的待发送数据
+    if (!outputDrained())
+    {
+        return 0;
+    }
+
+    ssize_t nwrote = ::writev(channel_.fd(), vec, count);
+    if (nwrote >= 0)
+    {
+        touchIdle();
+        loop_->addBytesWritten(nwrote);
+        if (static_cast<size_t>(nwrote) == total && writeCompleteCallback_) // 完全发送完，注册过回调
+        {
+            loop_->queueInLoop(
+                std::bind(writeCompleteCallback_, shared_from_this()),
+                &TcpConnection::describe, this
+            );
+        }
+        return nwrote;
+    }
+
+    if (errno != EWOULDBLOCK) // ewouldblock是非阻塞下没有数据的正常返回
+    {
+        LOG_ERROR("TcpConnection::writeDirect \n");
+        if (errno == EPIPE || errno == ECONNRESET) // 接收到对端socket重置
+        {
+            *faultError = true; // 错误发生
+        }
+    }
+    return 0;
+}
 
+void TcpConnection::checkHighWaterMark(size_t adding)
+{
+    size_t oldLen = outputBuffer_.readableBytes() + pendingBytes_; // 发送缓冲区之前剩余的待发送数据长度
+    if (oldLen + adding >= highWaterMark_ && oldLen < highWaterMark_) // 超过高水位
+    {
+        loop_->addHighWaterMarkHit();
+        if (highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(
+                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + adding),
+                &TcpConnection::describe, this
+            );
+        }
+    }
+}
+
+void TcpConnection::sendvInLoop(const struct iovec *slices, int count)
+{
     // 之前调用过connection的shutdown
     if (state_ == kDisconnected)
     {
@@ -90,55 +241,286 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
         return;
     }
 
-    // channel_不在发送数据，而且缓冲没有之前的待发送数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    size_t total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        total += slices[i].iov_len;
+    }
+
+    bool faultError = false;
+    size_t nwrote = 0; // writev后已发送的数据长度
+    if (count <= kMaxIovecs)
+    {
+        nwrote = writeDirect(slices, count, total, &faultError);
+    }
+
+    /**
+     * 当前write没有把数据全部发送，需要把剩余数据保存缓冲区，然后给channel注册
+     * epollout事件，poller发现tcp的发送缓冲区有空间，会通知相应的sock即channel，执行回调
+     * 有write事件就调用TcpConnection::handleWrite，把发送缓冲区的数据全部发送
+     * slices指向调用者的内存，剩下的部分只能拷贝
+    */
+    if (faultError || nwrote == total)
+    {
+        return;
+    }
+    checkHighWaterMark(total - nwrote);
+    for (int i = 0; i < count; ++i)
+    {
+        const char *data = static_cast<const char*>(slices[i].iov_base);
+        size_t len = slices[i].iov_len;
+        if (nwrote >= len)
+        {
+            nwrote -= len;
+            continue;
+        }
+        if (pendingOutput_.empty())
+        {
+            outputBuffer_.append(data + nwrote, len - nwrote); // 缓冲区已发送一部分，添加data剩余的到write缓冲区
+        }
+        else // 前面还有排队的文件或片段，排到它们之后
+        {
+            appendPending(data + nwrote, len - nwrote);
+        }
+        nwrote = 0;
+    }
+    if (!channel_.isWriting())
+    {
+        channel_.enableWriting(); // 这里要注册channel感兴趣的写事件，否则poller无法通知channel关于epollout
+    }
+}
+
+void TcpConnection::sendPiecesInLoop(std::vector<std::string> &pieces)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing! \n");
+        return;
+    }
+
+    struct iovec vec[kMaxIovecs];
+    int count = 0;
+    size_t total = 0;
+    for (const std::string &piece : pieces)
     {
-        nwrote = ::write(channel_->fd(), data, len);
-        if (nwrote >= 0) // 完全发送完
+        if (count < kMaxIovecs)
         {
-            remaining = len - nwrote;
-            if (remaining == 0 && writeCompleteCallback_) // 注册过回调
+            vec[count].iov_base = const_cast<char*>(piece.data());
+            vec[count].iov_len = piece.size();
+            ++count;
+        }
+        total += piece.size();
+    }
+
+    bool faultError = false;
+    size_t nwrote = 0;
+    if (static_cast<size_t>(count) == pieces.size())
+    {
+        nwrote = writeDirect(vec, count, total, &faultError);
+    }
+    if (faultError || nwrote == total)
+    {
+        return;
+    }
+
+    // 片段的所有权在连接手里，剩下的原样排队，不拼接
+    checkHighWaterMark(total - nwrote);
+    for (std::string &piece : pieces)
+    {
+        if (nwrote >= piece.size())
+        {
+            nwrote -= piece.size();
+            continue;
+        }
+        queuePiece(std::move(piece), nwrote);
+        nwrote = 0;
+    }
+    if (!channel_.isWriting())
+    {
+        channel_.enableWriting();
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        loop_->runInLoop(std::bind(
+            &TcpConnection::sendFileInLoop,
+            shared_from_this(),
+            fd,
+            offset,
+            len
+        ), &TcpConnection::describe, this);
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up sending file! \n");
+        return;
+    }
+
+    // 没有排队的数据，直接尝试发送
+    if (outputDrained())
+    {
+        ssize_t n = 0;
+        do
+        {
+            n = ::sendfile(channel_.fd(), fd, &offset, len);
+            if (n > 0)
             {
-                //
-                loop_->queueInLoop(
-                    std::bind(writeCompleteCallback_, shared_from_this())
-				);
+                touchIdle();
+                loop_->addBytesWritten(n);
+                len -= n;
             }
-        }
-        else // nwrote < 0
+            // 边缘触发下写事件一直注册着，短写之后排队不会带来新的EPOLLOUT，原因同writeFileSegment
+        } while (edgeTriggered_ && n > 0 && len > 0);
+
+        if (n >= 0 && len == 0)
         {
-            nwrote = 0;
-            if (errno != EWOULDBLOCK) // ewouldblock是非阻塞下没有数据的正常返回
+            if (writeCompleteCallback_)
             {
-                LOG_ERROR("TcpConnection::sendInLoop \n");
-                if (errno == EPIPE || errno == ECONNRESET) // 接收到对端socket重置
-                {
-                    faultError = true; // 错误发生
-                }
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this()),
+                    &TcpConnection::describe, this
+                );
             }
+            return;
+        }
+        else if (n < 0 && errno != EWOULDBLOCK)
+        {
+            // 和sendInLoop的faultError一样不再排队；对端重置（EPIPE/ECONNRESET）或者文件出错之后，
+            // 字节流缺了这一段，后面发的数据已经没有意义，关闭连接让双方都能发现
+            LOG_ERROR("TcpConnection::sendFileInLoop sendfile err:%d \n", errno);
+            forceClose();
+            return;
         }
     }
 
-    /**
-     * 当前write没有把数据全部发送，需要把剩余数据保存缓冲区，然后给channel注册
-     * epollout事件，poller发现tcp的发送缓冲区有空间，会通知相应的sock即channel，执行回调
-     * 有write事件就调用TcpConnection::handleWrite，把发送缓冲区的数据全部发送
-    */
-    if (!faultError && remaining > 0)
+    OutputSegment segment;
+    segment.fileFd = fd;
+    segment.offset = offset;
+    segment.remaining = len;
+    pendingOutput_.push_back(std::move(segment));
+    if (!channel_.isWriting())
+    {
+        channel_.enableWriting();
+    }
+}
+
+void TcpConnection::appendPending(const char *data, size_t len)
+{
+    // 小数据合并到末尾的数据段，大片段单独成段，避免拷贝已经排队的大块数据
+    if (pendingOutput_.empty() || pendingOutput_.back().fileFd >= 0
+        || pendingOutput_.back().remaining >= kMergeLimit)
+    {
+        queuePiece(std::string(data, len), 0);
+        return;
+    }
+    OutputSegment &segment = pendingOutput_.back();
+    segment.data.append(data, len);
+    segment.remaining += len;
+    pendingBytes_ += len;
+}
+
+void TcpConnection::queuePiece(std::string &&data, size_t offset)
+{
+    OutputSegment segment;
+    segment.fileFd = -1;
+    segment.offset = offset;
+    segment.remaining = data.size() - offset;
+    segment.data = std::move(data);
+    pendingBytes_ += segment.remaining;
+    pendingOutput_.push_back(std::move(segment));
+}
+
+bool TcpConnection::writeBuffers()
+{
+    // outputBuffer_和紧随其后的数据段一次writev发出去
+    struct iovec vec[kMaxIovecs];
+    int count = 0;
+    size_t total = outputBuffer_.readableBytes();
+    for (auto it = pendingOutput_.begin();
+         it != pendingOutput_.end() && it->fileFd < 0 && count < kMaxIovecs;
+         ++it)
     {
-        size_t oldLen = outputBuffer_.readableBytes(); // 发送缓冲区之前剩余的待发送数据长度
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_) // 超过高水位
+        vec[count].iov_base = &it->data[it->offset];
+        vec[count].iov_len = it->remaining;
+        total += it->remaining;
+        ++count;
+    }
+
+    int savedErrno = 0;
+    ssize_t n = outputBuffer_.writeFd(channel_.fd(), vec, count, &savedErrno);
+    if (n <= 0)
+    {
+        if (n < 0 && savedErrno != EWOULDBLOCK)
         {
-            loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining)
-            );
+            LOG_ERROR("TcpConnection::handleWrite \n");
         }
-        outputBuffer_.append((char*)data + nwrote, remaining); // 缓冲区已发送一部分，添加data剩余的到write缓冲区
-        if (!channel_->isWriting())
+        return false;
+    }
+
+    touchIdle();
+    loop_->addBytesWritten(n);
+    const bool all = static_cast<size_t>(n) == total;
+    size_t left = n;
+    size_t fromBuffer = std::min(left, outputBuffer_.readableBytes());
+    outputBuffer_.retrieve(fromBuffer);
+    left -= fromBuffer;
+    while (left > 0)
+    {
+        OutputSegment &segment = pendingOutput_.front();
+        if (left >= segment.remaining)
         {
-            channel_->enableWriting(); // 这里要注册channel感兴趣的写事件，否则poller无法通知channel关于epollout
+            left -= segment.remaining;
+            pendingBytes_ -= segment.remaining;
+            pendingOutput_.pop_front();
+        }
+        else
+        {
+            segment.offset += left;
+            segment.remaining -= left;
+            pendingBytes_ -= left;
+            left = 0;
         }
     }
+    // 没写完一般是socket发送缓冲区满了，但也可能是outputBuffer_的块数超过了一次writev的上限；
+    // 边缘触发下缓冲区不满就不会再有EPOLLOUT，所以继续写到EAGAIN为止
+    return all || edgeTriggered_;
+}
+
+bool TcpConnection::writeFileSegment()
+{
+    OutputSegment &segment = pendingOutput_.front();
+    ssize_t n = ::sendfile(channel_.fd(), segment.fileFd, &segment.offset, segment.remaining);
+    if (n > 0)
+    {
+        touchIdle();
+        loop_->addBytesWritten(n);
+        segment.remaining -= n;
+        if (segment.remaining > 0)
+        {
+            // 一般是socket发送缓冲区满了，等下一次EPOLLOUT；但sendfile也可能因为单次上限或者
+            // 页缓存读得不够返回得短，边缘触发下不会再有EPOLLOUT，所以继续写到EAGAIN为止
+            return edgeTriggered_;
+        }
+        pendingOutput_.pop_front();
+        return true;
+    }
+    if (n < 0 && errno == EWOULDBLOCK)
+    {
+        return false;
+    }
+    // 文件比预期的短，或者出错：对端收到的字节流缺了一段，放弃剩下的发送并关闭连接
+    LOG_ERROR("TcpConnection::writeFileSegment sendfile fd=%d err:%d remaining:%lu \n",
+              segment.fileFd, n < 0 ? errno : 0, segment.remaining);
+    pendingOutput_.pop_front();
+    forceClose();
+    return false;
 }
 
 void TcpConnection::shutdown()
@@ -147,16 +529,91 @@ void TcpConnection::shutdown()
     {
         setState(kDisconnecting);
         loop_->runInLoop(
-            std::bind(&TcpConnection::shutdownInLoop, this)
+            std::bind(&TcpConnection::shutdownInLoop, this),
+            &TcpConnection::describe, this
         );
     }
 }
 
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // 说明outputBuffer中的数据已经全部发送
+    if (outputDrained()) // 说明outputBuffer中的数据已经全部发送
+    {
+        socket_.shutdownWrite();
+    }
+}
+
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()),
+            &TcpConnection::describe, this
+        );
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose(); // 和对端关闭一样通知用户并从TcpServer/TcpClient中移除
+    }
+}
+
+void TcpConnection::setReadSizeRange(size_t minSize, size_t maxSize)
+{
+    readSizer_ = ReadSizer(minSize, maxSize);
+}
+
+void TcpConnection::setIdleTimeout(double seconds)
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::setIdleTimeoutInLoop, shared_from_this(), seconds),
+        &TcpConnection::describe, this
+    );
+}
+
+void TcpConnection::setIdleTimeoutInLoop(double seconds)
+{
+    idleTimeout_ = seconds;
+    if (seconds > 0 && state_ == kConnected)
+    {
+        loop_->timingWheel()->touch(&idleEntry_, seconds);
+    }
+    else
+    {
+        idleEntry_.cancel();
+    }
+}
+
+void TcpConnection::setReadDeadline(double seconds)
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::setReadDeadlineInLoop, shared_from_this(), seconds),
+        &TcpConnection::describe, this
+    );
+}
+
+void TcpConnection::setReadDeadlineInLoop(double seconds)
+{
+    if (seconds > 0 && state_ == kConnected)
+    {
+        loop_->timingWheel()->touch(&readDeadlineEntry_, seconds);
+    }
+    else
+    {
+        readDeadlineEntry_.cancel();
+    }
+}
+
+void TcpConnection::touchIdle()
+{
+    if (idleTimeout_ > 0 && idleEntry_.linked())
     {
-        socket_->shutdownWrite();
+        loop_->timingWheel()->touch(&idleEntry_, idleTimeout_);
     }
 }
 
@@ -165,8 +622,17 @@ void TcpConnection::connectEstablished()
     setState(kConnected);
     // 防止channel正在执行TcpConnection给它注册的回调对象时，TcpConnection异常地没有了
     // 因为TcpConnection直接给到用户，其状态不可控
-    channel_->tie(shared_from_this());
-    channel_->enableReading(); // 注册epollIn事件
+    channel_.tie(shared_from_this());
+    if (edgeTriggered_)
+    {
+        // 边缘触发：读写事件一次注册，之后不再修改
+        channel_.setEdgeTriggered(true);
+        channel_.enableAll();
+    }
+    else
+    {
+        channel_.enableReading(); // 注册epollIn事件
+    }
 
     // 执行新连接建立的回调
     connectionCallback_(shared_from_this());
@@ -177,25 +643,80 @@ void TcpConnection::connectDestroyed()
     if (state_ == kConnected)
     {
         setState(kDisconnected);
-        channel_->disableAll();
+        channel_.disableAll();
         connectionCallback_(shared_from_this());
     }
-    channel_->remove();
+    idleEntry_.cancel();
+    readDeadlineEntry_.cancel();
+    bufferIdleEntry_.cancel();
+    // 缓冲块在loop线程归还给loop的池，TcpConnection本身可能在其他线程析构
+    outputBuffer_.retrieveAll();
+    pendingOutput_.clear();
+    pendingBytes_ = 0;
+    channel_.remove();
+    loop_->addActiveConnections(-1);
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    // 边缘触发下排队的续读可能晚于连接关闭执行
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0)
+    size_t total = 0; // 本次事件读到的总字节数
+    ssize_t n = 0;
+    while (true)
     {
+        const size_t hint = readSizer_.next();
+        n = inputBuffer_.readFd(channel_.fd(), &savedErrno, hint);
+        if (n <= 0)
+        {
+            break;
+        }
+        readSizer_.record(n);
+        total += n;
+        // 没读满说明内核缓冲已经读空；超过预算就把剩下的留给下一轮poll，保证同一loop上其他连接的公平
+        // 边缘触发下不能据此停下：和数据一起到达的FIN不会再有新的通知，必须读到EAGAIN或者0
+        if (static_cast<size_t>(n) < hint && !edgeTriggered_)
+        {
+            break;
+        }
+        if (total >= readBudget_ && (!edgeTriggered_ || readBudget_ > 0))
+        {
+            if (edgeTriggered_)
+            {
+                // 边缘触发不会再通知剩下的数据，排到本轮其他事件之后接着读
+                loop_->queueInLoop(
+                    std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime),
+                    &TcpConnection::describe, this
+                );
+            }
+            break;
+        }
+    }
+
+    if (total > 0)
+    {
+        touchIdle();
+        loop_->addBytesRead(total);
+        readDeadlineEntry_.cancel(); // 收到数据，读超时失效
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        if (inputBuffer_.internalCapacity() > Buffer::kCheapPrepend)
+        {
+            loop_->timingWheel()->touch(&bufferIdleEntry_, kBufferIdleSeconds);
+        }
     }
-    else if (n == 0)
+
+    if (n == 0)
     {
-        handleClose();
+        if (state_ != kDisconnected)
+        {
+            handleClose();
+        }
     }
-    else
+    else if (n < 0 && savedErrno != EWOULDBLOCK) // 读过数据之后的EAGAIN是正常的
     {
         errno = savedErrno;
         LOG_ERROR("Tcp Connection::handleRead");
@@ -205,47 +726,65 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 
 void TcpConnection::handleWrite()
 {
-    if (channel_->isWriting())
+    if (channel_.isWriting())
     {
-        int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
-        if (n > 0)
+        // 边缘触发模式下写事件常驻，socket变得可写时可能并没有待发送的数据
+        const bool hadOutput = !outputDrained();
+        bool writable = true;
+        // 按顺序发送：outputBuffer_和数据段用writev，文件段用sendfile
+        while (writable && !outputDrained())
         {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0)
+            if (outputBuffer_.readableBytes() == 0 && pendingOutput_.front().fileFd >= 0)
+            {
+                writable = writeFileSegment();
+            }
+            else
             {
-                channel_->disableWriting();
-                if (writeCompleteCallback_)
-                {
-                    loop_->queueInLoop(
-                        std::bind(writeCompleteCallback_, shared_from_this())
-					);
-                }
-                // 发送完发现state_为kDisconnecting，则发送过程中有个地方数据没有发送完
-                // 就调用了shutdown，而且没有真正shutdown
-                if (state_ == kDisconnecting)
-                {
-                    shutdownInLoop();
-                }
+                writable = writeBuffers();
             }
         }
-        else
+
+        if (hadOutput && outputDrained())
         {
-            LOG_ERROR("TcpConnection::handleWrite \n");
+            if (!edgeTriggered_)
+            {
+                channel_.disableWriting();
+            }
+            if (writeCompleteCallback_)
+            {
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this()),
+                    &TcpConnection::describe, this
+                );
+            }
+            // 发送完发现state_为kDisconnecting，则发送过程中有个地方数据没有发送完
+            // 就调用了shutdown，而且没有真正shutdown
+            if (state_ == kDisconnecting)
+            {
+                shutdownInLoop();
+            }
         }
     }
-    else // 不可写
+    else if (!edgeTriggered_) // 不可写；边缘触发下同一次事件里读到关闭后仍会带着EPOLLOUT，不算错误
     {
-        LOG_ERROR("TcpConnection fd=%d is down, no more writing \n", channel_->fd());
+        LOG_ERROR("TcpConnection fd=%d is down, no more writing \n", channel_.fd());
     }
 }
 
 // poller =>（通知） channel::closeCallback => handleClose
 void TcpConnection::handleClose()
 {
-    LOG_INFO("TcpConnection::handleClose fd=%d state=%d \n", channel_->fd(), (int)state_);
+    LOG_INFO("TcpConnection::handleClose fd=%d state=%d \n", channel_.fd(), (int)state_);
+    // 同一轮循环里超时和对端关闭可能先后触发，只处理第一次，避免重复通知用户和重复移除连接
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
     setState(kDisconnected);
-    channel_->disableAll();
+    channel_.disableAll();
+    idleEntry_.cancel();
+    readDeadlineEntry_.cancel();
+    bufferIdleEntry_.cancel();
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr); // 关闭连接的回调，通知用户连接关闭
@@ -257,7 +796,7 @@ void TcpConnection::handleError()
     int optVal;
     socklen_t optlen = sizeof optVal;
     int err = 0;
-    if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &optVal, &optlen) < 0)
+    if (::getsockopt(channel_.fd(), SOL_SOCKET, SO_ERROR, &optVal, &optlen) < 0)
     {
         err = errno;
     }
@@ -265,5 +804,23 @@ void TcpConnection::handleError()
     {
         err = optVal;
     }
-    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
+    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name().c_str(), err);
+}
+
+void TcpConnection::handleTimeout()
+{
+    LOG_INFO("TcpConnection::handleTimeout [%lu] fd=%d \n", static_cast<unsigned long>(id_), channel_.fd());
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
+void TcpConnection::handleBufferIdle()
+{
+    // 还有没处理完的半个消息就保留
+    if (inputBuffer_.readableBytes() == 0)
+    {
+        inputBuffer_.shrink(0);
+    }
 }
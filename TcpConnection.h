@@ -4,15 +4,23 @@
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
+#include "Socket.h"
+#include "Channel.h"
 
 #include <memory>
 #include <string>
 #include <atomic>
+#include <mutex> // once_flag
+#include <deque>
+#include <vector>
+#include <sys/types.h>
+#include <stdint.h>
 
-class Channel;
 class EventLoop;
-class Socket;
+struct iovec;
 
 class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection> // 使用shared_from_this
 {
@@ -22,10 +30,21 @@ public:
                 int sockfd,
                 const InetAddress& localAddr,
                 const InetAddress& peerAddr);
+    // 用整数id标识连接，名字在第一次调用name()时才由namePrefix和id拼出来
+    TcpConnection(EventLoop *loop,
+                uint64_t id,
+                std::shared_ptr<const std::string> namePrefix,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr);
     ~TcpConnection();
 
     EventLoop* getLoop() const { return loop_; }
-    const std::string& name() const { return name_; }
+    uint64_t id() const { return id_; }
+    int fd() const { return socket_.fd(); }
+    const std::string& name() const;
+    // 以连接名作为DescribeCallback，慢回调报告里标识这个连接的回调
+    static std::string describe(const void *conn);
     const InetAddress& localAddress() const { return localAddr_; }
     const InetAddress& peerAddress() const { return peerAddr_; }
 
@@ -33,8 +52,33 @@ public:
 
     // 发送数据，默认为string
     void send(const std::string &buf);
+    // 分散发送，多个片段一次writev发出，不需要先拼接
+    // slices指向调用者的内存：loop线程内调用时直接writev，没写完的部分拷贝进发送缓冲；跨线程调用会先拷贝
+    void sendv(const struct iovec *slices, int count);
+    // pieces的所有权交给连接，没写完的片段原样排队，不会拼接成一块
+    void sendv(std::vector<std::string> pieces);
+    // 用sendfile零拷贝发送文件fd的[offset, offset + len)，排在之前send的数据之后，发送完触发WriteCompleteCallback
+    // fd由调用者管理，在WriteCompleteCallback或者连接断开之前不能close
+    void sendFile(int fd, off_t offset, size_t len);
     // 关闭连接
     void shutdown();
+    // 不等待发送缓冲发完，直接关闭连接
+    void forceClose();
+    void setTcpNoDelay(bool on) { socket_.setTcpNoDelay(on); }
+
+    // 空闲超时：seconds秒内没有任何读写就关闭连接，每次读写都会刷新，0表示取消
+    void setIdleTimeout(double seconds);
+    // 读超时：seconds秒内没有收到数据就关闭连接，收到数据后失效，需要的话在messageCallback里重新设置
+    void setReadDeadline(double seconds);
+
+    // 读策略，在连接建立前或者loop线程里调用
+    // 每次readv预留的大小在[minSize, maxSize]之间，按最近的读取量自适应：大流量传输读得多，小包RPC不浪费内存
+    void setReadSizeRange(size_t minSize, size_t maxSize);
+    // 每个可读事件最多连续读取的字节数，0表示每个事件只读一次
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+    // 边缘触发模式，需要在连接建立前设置：读写都进行到EAGAIN，写事件常驻不再反复epoll_ctl
+    // 边缘触发下readBudget为0表示一直读到EAGAIN，非0时读满预算后排到本轮其他事件之后继续读
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
 
     void setConnectionCallback(const ConnectionCallback &cb)
     { connectionCallback_ = cb; }
@@ -65,18 +109,47 @@ private:
     void handleWrite();
     void handleClose();
     void handleError();
+    // 时间轮上的超时到期
+    void handleTimeout();
+    // 连接一段时间没有读到数据，归还接收缓冲多占的内存
+    void handleBufferIdle();
+
+    void setIdleTimeoutInLoop(double seconds);
+    void setReadDeadlineInLoop(double seconds);
+    // 有读写时刷新空闲超时，O(1)
+    void touchIdle();
 
     // 发送数据：应用发送快，内核处理慢，所以置缓冲
     void sendInLoop(const void *message, size_t len);
+    void sendvInLoop(const struct iovec *slices, int count);
+    void sendPiecesInLoop(std::vector<std::string> &pieces);
+    void sendFileInLoop(int fd, off_t offset, size_t len);
+    // 没有排队的数据时直接writev，返回写出的字节数
+    size_t writeDirect(const struct iovec *vec, int count, size_t total, bool *faultError);
+    void checkHighWaterMark(size_t adding);
+    // 追加到pendingOutput_末尾（拷贝），保证排在已排队的文件和片段之后
+    void appendPending(const char *data, size_t len);
+    // 转移所有权排队，offset之前的部分已经发送
+    void queuePiece(std::string &&data, size_t offset);
+    // handleWrite使用，返回false表示socket写不下了或者出错
+    bool writeBuffers();
+    bool writeFileSegment();
+    // 所有待发送数据都发完了
+    bool outputDrained() const { return outputBuffer_.readableBytes() == 0 && pendingOutput_.empty(); }
     void shutdownInLoop();
+    void forceCloseInLoop();
     
     EventLoop *loop_; // 绝对不是baseLoop_，因为TcpConnection是在里面subLoop管理的
-    const std::string name_;
+    const uint64_t id_;
+    const std::shared_ptr<const std::string> namePrefix_;
+    mutable std::string name_;
+    mutable std::once_flag nameOnce_;
     std::atomic_int state_;
     bool reading_;
 
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
+    // 直接作为成员，和连接对象在同一块内存里；channel_用到socket_的fd，必须在其后声明
+    Socket socket_;
+    Channel channel_;
 
     const InetAddress localAddr_;
     const InetAddress peerAddr_;
@@ -93,6 +166,29 @@ private:
     CloseCallback closeCallback_;
     size_t highWaterMark_; // 高水位就是控制双方数据的收发要保持限度内
 
+    double idleTimeout_; // 空闲超时秒数，0表示不启用
+    TimingWheel::Entry idleEntry_; // 挂在loop_的时间轮上
+    TimingWheel::Entry readDeadlineEntry_;
+    TimingWheel::Entry bufferIdleEntry_; // 接收缓冲持有内存时挂上，空闲后收缩
+
+    ReadSizer readSizer_; // 自适应的单次读取大小
+    size_t readBudget_; // 每个可读事件的读取预算
+    bool edgeTriggered_;
+
     Buffer inputBuffer_; // 接收数据的缓冲
-    Buffer outputBuffer_; // 发送数据的缓冲
+    ChainBuffer outputBuffer_; // 发送数据的缓冲，分块存储，对端读得慢时追加也不会搬动已有数据
+
+    // 排在outputBuffer_之后等待发送的文件段和数据片段，按顺序发送
+    struct OutputSegment
+    {
+        int fileFd; // -1表示数据段
+        off_t offset; // 文件段是文件偏移，数据段是data中已发送的字节数
+        size_t remaining; // 剩余待发送的字节数
+        std::string data;
+    };
+    static const int kMaxIovecs = 64; // 一次writev最多的片段数
+    static const size_t kMergeLimit = 4096; // 小于它的数据段可以继续追加
+
+    std::deque<OutputSegment> pendingOutput_;
+    size_t pendingBytes_; // pendingOutput_里数据段的字节数，算入高水位
 };
@@ -2,9 +2,12 @@
 #include "Logger.h"
 #include "InetAddress.h"
 #include "TcpConnection.h"
+#include "ObjectPool.h"
 
 #include <strings.h>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -22,29 +25,74 @@ TcpServer::TcpServer(EventLoop *loop,
     : loop_(CheckLoopNotNull(loop))
     , ipPort_(listenAddr.toIpPort())
     , name_(nameArg)
-    , acceptor_(new Acceptor(loop, listenAddr, option == kReusePort))
+    , option_(option)
+    , listenAddr_(listenAddr)
+    , acceptor_(new Acceptor(loop, listenAddr, option != kNoReusePort))
     , threadPool_(new EventLoopThreadPool(loop, name_))
     , connectionCallback_()
     , messageCallback_()
+    , started_(0)
+    , readMinSize_(ReadSizer::kDefaultMin)
+    , readMaxSize_(ReadSizer::kDefaultMax)
+    , readBudget_(0)
+    , edgeTriggered_(false)
+    , acceptBatch_(Acceptor::kDefaultAcceptBatch)
     , nextConnId_(1)
-	, started_(0)
-
+    , connNamePrefix_(std::make_shared<const std::string>(nameArg + "-" + ipPort_ + "#"))
+    , localAddrFixed_(listenAddr.getSockAddr()->sin_addr.s_addr != htonl(INADDR_ANY)
+                      && listenAddr.getSockAddr()->sin_port != 0)
 {
     // 新用户连接时，执行TcpServer::newConnection
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
-		std::placeholders::_1, std::placeholders::_2));
+    acceptor_->setNewConnectionBatchCallback(std::bind(&TcpServer::newConnectionBatch, this,
+		std::placeholders::_1));
 }
 
 TcpServer::~TcpServer()
 {
-    for (auto &item : connections_)
+    /**
+     * 连接和subLoop的acceptor都在各自的loop线程里销毁，并等待全部完成：
+     * 完成之后不会再有连接回调TcpServer::removeConnection，也不会再有新连接
+    */
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t remaining = loops.size();
+    for (size_t i = 0; i < loops.size(); ++i)
     {
-        // 局部的智能指针对象在作用域外会自动释放new出来的TcpConnection对象
-        TcpConnectionPtr conn(item.second);
-        item.second.reset(); // 解除强智能指针
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn)
-        );
+        EventLoop *ioLoop = loops[i];
+        auto it = connections_.find(ioLoop);
+        ConnectionMap *connections = it != connections_.end() ? &it->second : nullptr;
+        Acceptor *acceptor = i < loopAcceptors_.size() ? loopAcceptors_[i].release() : nullptr;
+        if (connections == nullptr && acceptor == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --remaining; // 没有要在这个loop上销毁的东西，不用等它
+            continue;
+        }
+
+        ioLoop->runInLoop([connections, acceptor, &mutex, &cond, &remaining]() {
+            delete acceptor;
+            if (connections)
+            {
+                ConnectionMap conns;
+                conns.swap(*connections);
+                for (auto &item : conns)
+                {
+                    item.second->connectDestroyed();
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+            {
+                cond.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (remaining > 0)
+    {
+        cond.wait(lock);
     }
 }
 
@@ -58,69 +106,147 @@ void TcpServer::start()
     if (started_++ == 0) // 防止一个TcpServer对象被start多次
     {
         threadPool_->start(threadInitCallback_);                         // 启动loop线程池
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get())); // poller开启事件循环，监听acceptChannel上的事件
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        for (EventLoop *ioLoop : loops)
+        {
+            connections_[ioLoop]; // 先建好每个loop的连接表，之后外层的表不再变化，各loop只用at()访问自己的表
+        }
+        if (option_ == kReusePortPerLoop && loops.front() != loop_)
+        {
+            // 每个subLoop绑定同一地址各自监听，mainLoop的acceptor只占住端口不监听
+            for (size_t i = 0; i < loops.size(); ++i)
+            {
+                EventLoop *ioLoop = loops[i];
+                Acceptor *acceptor = new Acceptor(ioLoop, listenAddr_, true);
+                int cpu = threadPool_->loopCpu(i);
+                if (cpu >= 0)
+                {
+                    acceptor->setIncomingCpu(cpu); // 中断在这个cpu上的连接优先交给绑在它上面的loop
+                }
+                acceptor->setNewConnectionCallback(std::bind(&TcpServer::createConnection, this,
+                    ioLoop, std::placeholders::_1, std::placeholders::_2));
+                acceptor->setAcceptBatch(acceptBatch_);
+                loopAcceptors_.push_back(std::unique_ptr<Acceptor>(acceptor));
+                ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor));
+            }
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get())); // poller开启事件循环，监听acceptChannel上的事件
+        }
+    }
+}
+
+void TcpServer::newConnectionBatch(const Acceptor::AcceptedList &accepted)
+{
+    /**
+     * 按配置的策略从threadPool_选择subLoop，每个subLoop的这批连接打包成一个任务，只唤醒一次
+     * 连接对象在subLoop线程里创建，从subLoop自己的对象池分配，之后也在那里释放复用
+     * 选中时先给subLoop的连接数占个位，创建之后由连接自己计数，同一批里的选择也能看到前面的分配
+    */
+    std::vector<std::pair<EventLoop*, Acceptor::AcceptedList>> batches;
+    for (const auto &item : accepted)
+    {
+        EventLoop *ioLoop = threadPool_->getNextLoop(item.first, item.second);
+        ioLoop->addActiveConnections(1);
+        size_t i = 0;
+        while (i < batches.size() && batches[i].first != ioLoop)
+        {
+            ++i;
+        }
+        if (i == batches.size())
+        {
+            batches.emplace_back(ioLoop, Acceptor::AcceptedList());
+        }
+        batches[i].second.push_back(item);
+    }
+
+    for (auto &batch : batches)
+    {
+        batch.first->runInLoop(std::bind(&TcpServer::establishConnections, this,
+            batch.first, std::move(batch.second)));
+    }
+}
+
+void TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    // 已经在ioLoop线程，直接创建、登记并建立
+    TcpConnectionPtr conn = makeConnection(ioLoop, sockfd, peerAddr);
+    connections_.at(ioLoop)[conn->id()] = conn;
+    conn->connectEstablished();
+}
+
+void TcpServer::establishConnections(EventLoop *ioLoop, const Acceptor::AcceptedList &accepted)
+{
+    // 同一批里分到同一个subLoop的连接，在那个loop上依次创建、登记并建立
+    ConnectionMap &connections = connections_.at(ioLoop);
+    for (const auto &item : accepted)
+    {
+        TcpConnectionPtr conn = makeConnection(ioLoop, item.first, item.second);
+        ioLoop->addActiveConnections(-1); // 归还newConnectionBatch占的位
+        connections[conn->id()] = conn;
+        conn->connectEstablished();
     }
 }
 
-void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
+TcpConnectionPtr TcpServer::makeConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
 {
-    // 轮询threadPool_，选择一个subLoop来管理channel
-    EventLoop *ioLoop = threadPool_->getNextLoop();
-    char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    std::string connName = name_ + buf;
-
-    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
-        name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
-
-    // 通过sockfd获取其绑定的本机的ip地址端口号
-    sockaddr_in local;
-    ::bzero(&local, sizeof local);
-    socklen_t addrlen = sizeof local;
-    if (::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0)
+    uint64_t id = nextConnId_.fetch_add(1, std::memory_order_relaxed);
+
+    LOG_INFO("TcpServer::newConnection [%s] - new connection [%lu] from %s \n",
+        name_.c_str(), static_cast<unsigned long>(id), peerAddr.toIpPort().c_str());
+
+    // 监听的是具体地址时本端地址就是它，否则通过sockfd获取其绑定的本机的ip地址端口号
+    InetAddress localAddr(listenAddr_);
+    if (!localAddrFixed_)
     {
-        LOG_ERROR("sockets::getLocalAddr");
+        sockaddr_in local;
+        ::bzero(&local, sizeof local);
+        socklen_t addrlen = sizeof local;
+        if (::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0)
+        {
+            LOG_ERROR("sockets::getLocalAddr");
+        }
+        localAddr.setSockAddr(local);
     }
-    InetAddress localAddr(local);
 
     // 根据连接成功的sockfd，创建TcpConnection连接对象
-    TcpConnectionPtr conn(new TcpConnection(
+    // 连接和shared_ptr控制块一次分配，槽位来自ioLoop的对象池
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(
+                            PoolAllocator<TcpConnection>(ioLoop->objectPool()),
                             ioLoop,
-                            connName,
+                            id,
+                            connNamePrefix_,
                             sockfd,
                             localAddr,
-                            peerAddr));
+                            peerAddr);
 
-    connections_[connName] = conn;
     // 绑定回调
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setReadSizeRange(readMinSize_, readMaxSize_);
+    conn->setReadBudget(readBudget_);
+    conn->setEdgeTriggered(edgeTriggered_);
 
     // 设置如何关闭连接的回调
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)
     );
-
-    // 直接调用TcpConnection::connectEstablished
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    return conn;
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 {
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn)
-    );
-}
-
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
-{
-    LOG_INFO("TcpServer::removeConnectionInLoop [%s] -connection %s \n",
-        name_.c_str(), conn->name().c_str());
-    connections_.erase(conn->name());
-    EventLoop *ioLoop = conn->getLoop(); // 拿到连接的loop
-    ioLoop->queueInLoop(
-        std::bind(&TcpConnection::connectDestroyed, conn)
-    );
+    LOG_INFO("TcpServer::removeConnection [%s] -connection [%lu] fd=%d \n",
+        name_.c_str(), static_cast<unsigned long>(conn->id()), conn->fd());
+    EventLoop *ioLoop = conn->getLoop(); // 拿到连接的loop，当前就在它的线程里
+    // 不在表里说明TcpServer正在析构，由析构函数负责销毁
+    if (connections_.at(ioLoop).erase(conn->id()) == 1)
+    {
+        ioLoop->queueInLoop(
+            std::bind(&TcpConnection::connectDestroyed, conn),
+            &TcpConnection::describe, conn.get()
+        );
+    }
 }
@@ -14,6 +14,7 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <vector>
 #include <unordered_map>
 
 class TcpServer : noncopyable
@@ -25,6 +26,9 @@ public:
     {
         kNoReusePort,
         kReusePort,
+        // 每个subLoop各自一个SO_REUSEPORT的Acceptor，由内核分散连接，
+        // 连接在接受它的loop上直接建立，不经过mainLoop；此时setLoopSelectPolicy不起作用
+        kReusePortPerLoop,
     };
 
     TcpServer(EventLoop *loop,
@@ -38,26 +42,56 @@ public:
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
 
+    // 新连接的读策略，见TcpConnection::setReadSizeRange/setReadBudget
+    // 大流量传输可以调大上限和预算，小包RPC保持默认
+    void setReadSizeRange(size_t minSize, size_t maxSize) { readMinSize_ = minSize; readMaxSize_ = maxSize; }
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+    // 新连接使用边缘触发模式，见TcpConnection::setEdgeTriggered
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+
+    // 每次监听socket可读时最多连续accept的连接数，需要在start之前设置
+    void setAcceptBatch(int batch) { acceptBatch_ = batch; acceptor_->setAcceptBatch(batch); }
+
     // 设置底层subloop的个数，通过threadPool_
     void setThreadNum(int numThreads);
+    // 新连接分配subLoop的策略，默认轮询，见EventLoopThreadPool::SelectPolicy
+    void setLoopSelectPolicy(EventLoopThreadPool::SelectPolicy policy) { threadPool_->setSelectPolicy(policy); }
+    void setLoopSelector(EventLoopThreadPool::LoopSelector selector) { threadPool_->setLoopSelector(std::move(selector)); }
+    // subLoop线程绑核和NUMA本地内存，需要在start之前设置，见EventLoopThreadPool::setCpuList
+    void setCpuList(std::vector<int> cpus) { threadPool_->setCpuList(std::move(cpus)); }
+    void setPinToCores(bool on) { threadPool_->setPinToCores(on); }
+    void setNumaLocal(bool on) { threadPool_->setNumaLocal(on); }
 
     // 开启服务器监听，一个线程只能执行一次start
     void start();
+
+    // 处理连接的各loop的运行统计，见EventLoopThreadPool::loopMetrics，start之后任意线程调用
+    std::vector<LoopMetrics> loopMetrics() { return threadPool_->loopMetrics(); }
+    LoopMetrics metrics() { return threadPool_->metrics(); }
 private:
     // 将与客户端通信的fd和客户端的ip地址端口号传给回调，由acceptor执行
-    // 只由mainLoop执行new这个函数
-    void newConnection(int sockfd, const InetAddress &peerAddr);
+    // mainLoop的acceptor调用，按策略选择subLoop
+    void newConnectionBatch(const Acceptor::AcceptedList &accepted);
+    // 在ioLoop上创建连接；kReusePortPerLoop时由subLoop自己的acceptor在ioLoop线程直接调用
+    void createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // 在ioLoop线程创建连接对象，还没有登记和建立
+    TcpConnectionPtr makeConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // 在ioLoop线程执行：创建连接，登记到ioLoop的连接表并建立连接
+    void establishConnections(EventLoop *ioLoop, const Acceptor::AcceptedList &accepted);
+    // 在连接所在的loop线程执行
     void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using ConnectionMap = std::unordered_map<uint64_t, TcpConnectionPtr>;
 
     EventLoop *loop_; // baseLoop_
 
     const std::string name_;
     const std::string ipPort_;
 
+    const Option option_;
+    const InetAddress listenAddr_;
     std::unique_ptr<Acceptor> acceptor_; // 监听新连接事件
+    std::vector<std::unique_ptr<Acceptor>> loopAcceptors_; // kReusePortPerLoop时每个subLoop的acceptor，和getAllLoops()一一对应
 
     std::shared_ptr<EventLoopThreadPool> threadPool_; // one loop per thread
 
@@ -68,6 +102,16 @@ private:
     ThreadInitCallback threadInitCallback_;
     std::atomic_int started_;
 
-    int nextConnId_;
-    ConnectionMap connections_; // 所有的连接
+    size_t readMinSize_;
+    size_t readMaxSize_;
+    size_t readBudget_;
+    bool edgeTriggered_;
+    int acceptBatch_;
+
+    std::atomic<uint64_t> nextConnId_;
+    const std::shared_ptr<const std::string> connNamePrefix_; // 连接名字的公共前缀 name-ip:port#
+    bool localAddrFixed_; // 监听的是具体的ip和端口，连接的本端地址就是listenAddr_，不用getsockname
+
+    // 每个loop各自的连接表，start时建好，之后只在对应的loop线程里增删，不需要加锁
+    std::unordered_map<EventLoop*, ConnectionMap> connections_;
 };
\ No newline at end of file
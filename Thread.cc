@@ -1,7 +1,13 @@
 #include "Thread.h"
 #include "CurrentThread.h"
+#include "Logger.h"
 
 #include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h> // MPOL_LOCAL
 
 std::atomic_int Thread::numCreated_(0);
 
@@ -11,6 +17,8 @@ Thread::Thread(ThreadFunc func, const std::string &name)
     , tid_(0)
     , func_(std::move(func))
     , name_(name)
+    , cpu_(-1)
+    , numaLocal_(false)
 {
     setDefaultName();
 }
@@ -32,6 +40,7 @@ void Thread::start()
     // lamda表达式，以引用的方式接受外部对象
     thread_ = std::shared_ptr<std::thread>(new std::thread([&](){
         tid_ = CurrentThread::tid();
+        applyPlacement();
         // 信号量资源+1
         sem_post(&sem);
         // 开启一个新线程，专门执行线程函数
@@ -47,6 +56,29 @@ void Thread::join()
     thread_->join();
 }
 
+void Thread::applyPlacement()
+{
+    if (cpu_ >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu_, &cpus);
+        int err = ::pthread_setaffinity_np(::pthread_self(), sizeof cpus, &cpus);
+        if (err != 0)
+        {
+            LOG_ERROR("Thread %s set affinity to cpu %d err:%d \n", name_.c_str(), cpu_, err);
+        }
+    }
+    if (numaLocal_)
+    {
+        // 之后这个线程首次访问的内存（EventLoop、缓冲块等）都分配在绑定的cpu所在节点
+        if (::syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) < 0)
+        {
+            LOG_ERROR("Thread %s set_mempolicy err:%d \n", name_.c_str(), errno);
+        }
+    }
+}
+
 void Thread::setDefaultName()
 {
     int num = ++numCreated_;
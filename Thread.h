@@ -17,6 +17,11 @@ public:
     explicit Thread(ThreadFunc func, const std::string &name = std::string());
     ~Thread();
 
+    // 在start之前设置：线程绑定到cpu上运行，-1表示不绑定
+    void setCpuAffinity(int cpu) { cpu_ = cpu; }
+    // 在start之前设置：线程分配内存时使用所在的NUMA节点（MPOL_LOCAL），不受进程级内存策略影响
+    void setNumaLocal(bool on) { numaLocal_ = on; }
+
     // 新建线程并获取tid_
     void start();
     // 
@@ -25,9 +30,12 @@ public:
     bool started() const { return started_; }
     pid_t tid() const { return tid_; }
     const std::string& name() const { return name_; }
+    int cpuAffinity() const { return cpu_; }
     static int numCreated() { return numCreated_; }
 private:
     void setDefaultName();
+    // 在新线程里执行，线程函数运行之前完成绑核和内存策略
+    void applyPlacement();
 
     bool started_; // 是否启动
     bool joined_; // 是否joined
@@ -35,5 +43,7 @@ private:
     pid_t tid_;
     ThreadFunc func_;
     std::string name_;
+    int cpu_;
+    bool numaLocal_;
     static std::atomic_int numCreated_; // 全局变量记录线程数
 };
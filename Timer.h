@@ -0,0 +1,46 @@
+// 定时器，由TimerQueue管理
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+#include <atomic>
+
+class Timer : noncopyable
+{
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(interval)
+        , repeat_(interval > 0.0)
+        , sequence_(++numCreated_)
+        , heapIndex_(-1)
+    {}
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    double interval() const { return interval_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器计算下一次到期时间
+    void restart(Timestamp now);
+
+    // 在TimerQueue最小堆中的下标，-1表示不在堆中
+    int heapIndex() const { return heapIndex_; }
+    void setHeapIndex(int index) { heapIndex_ = index; }
+
+    static int64_t numCreated() { return numCreated_; }
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_; // 到期时间
+    const double interval_; // 重复间隔，单位秒
+    const bool repeat_;
+    const int64_t sequence_; // 全局唯一序号，用于区分地址复用的Timer
+    int heapIndex_;
+
+    static std::atomic<int64_t> numCreated_;
+};
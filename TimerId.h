@@ -0,0 +1,25 @@
+// 定时器的标识，用户通过它取消定时器
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr)
+        , sequence_(0)
+    {}
+
+    TimerId(Timer *timer, int64_t seq)
+        : timer_(timer)
+        , sequence_(seq)
+    {}
+
+    friend class TimerQueue;
+private:
+    Timer *timer_;
+    int64_t sequence_; // timer_可能被释放后地址复用，靠序号区分
+};
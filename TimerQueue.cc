@@ -0,0 +1,259 @@
+#include "TimerQueue.h"
+#include "Timer.h"
+#include "TimerId.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <strings.h>
+#include <stdio.h>
+
+static int createTimerfd()
+{
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0)
+    {
+        LOG_FATAL("timerfd_create error:%d \n", errno);
+    }
+    return timerfd;
+}
+
+// 慢回调报告里的定时器描述：序号和重复间隔，和TimerId对应
+static std::string describeTimer(const void *p)
+{
+    const Timer *timer = static_cast<const Timer*>(p);
+    std::string desc = "timer#" + std::to_string(timer->sequence());
+    if (timer->repeat())
+    {
+        char buf[32];
+        snprintf(buf, sizeof buf, " every %.3fs", timer->interval());
+        desc += buf;
+    }
+    return desc;
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop)
+    , timerfd_(createTimerfd())
+    , timerfdChannel_(loop, timerfd_)
+    , callingExpiredTimers_(false)
+{
+    timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_.setDescription([](const void*) { return std::string("timerfd"); }, nullptr);
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue()
+{
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+    for (const Entry &entry : heap_)
+    {
+        delete entry.timer;
+    }
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
+{
+    Timer *timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer *timer)
+{
+    activeTimers_[timer->sequence()] = timer;
+    if (insert(timer)) // 新定时器最早到期，需要提前timerfd
+    {
+        resetTimerfd(timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+    auto it = activeTimers_.find(timerId.sequence_);
+    if (it == activeTimers_.end() || it->second != timerId.timer_)
+    {
+        return; // 已经到期释放，或者已经取消过
+    }
+
+    Timer *timer = it->second;
+    if (timer->heapIndex() >= 0)
+    {
+        removeAt(timer->heapIndex());
+        activeTimers_.erase(it);
+        delete timer;
+    }
+    else if (callingExpiredTimers_)
+    {
+        // 定时器正在本轮到期回调中（比如重复定时器在自己的回调里取消自己），回调结束后不再重启
+        cancelingTimers_.insert(timerId.sequence_);
+    }
+}
+
+void TimerQueue::handleRead()
+{
+    uint64_t howmany;
+    ssize_t n = ::read(timerfd_, &howmany, sizeof howmany);
+    if (n != sizeof howmany)
+    {
+        LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8 \n", n);
+    }
+
+    Timestamp now(Timestamp::now());
+    expired_.clear();
+    while (!heap_.empty() && !(now < heap_.front().when))
+    {
+        Timer *timer = heap_.front().timer;
+        removeAt(0);
+        expired_.push_back(timer);
+    }
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (Timer *timer : expired_)
+    {
+        Timestamp start = loop_->slowCallbackStart();
+        timer->run();
+        loop_->checkSlowCallback(EventLoop::kTimer, &describeTimer, timer, -1, start);
+    }
+    callingExpiredTimers_ = false;
+
+    // 重复定时器重新入堆，其余释放
+    for (Timer *timer : expired_)
+    {
+        if (timer->repeat() && cancelingTimers_.find(timer->sequence()) == cancelingTimers_.end())
+        {
+            timer->restart(now);
+            insert(timer);
+        }
+        else
+        {
+            activeTimers_.erase(timer->sequence());
+            delete timer;
+        }
+    }
+    expired_.clear();
+
+    if (!heap_.empty())
+    {
+        resetTimerfd(heap_.front().when);
+    }
+}
+
+void TimerQueue::resetTimerfd(Timestamp expiration)
+{
+    int64_t microseconds = expiration.microSecondsSinceEpoch()
+                           - Timestamp::now().microSecondsSinceEpoch();
+    if (microseconds < 100) // 已经到期的也要让timerfd尽快触发，不能设置为0（0表示停止）
+    {
+        microseconds = 100;
+    }
+
+    struct itimerspec newValue;
+    bzero(&newValue, sizeof newValue);
+    newValue.it_value.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+    newValue.it_value.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    if (::timerfd_settime(timerfd_, 0, &newValue, NULL) < 0)
+    {
+        LOG_ERROR("timerfd_settime error:%d \n", errno);
+    }
+}
+
+bool TimerQueue::insert(Timer *timer)
+{
+    Entry entry = { timer->expiration(), timer };
+    heap_.push_back(entry);
+    timer->setHeapIndex(static_cast<int>(heap_.size() - 1));
+    siftUp(heap_.size() - 1);
+    return heap_.front().timer == timer;
+}
+
+void TimerQueue::removeAt(size_t index)
+{
+    heap_[index].timer->setHeapIndex(-1);
+    size_t last = heap_.size() - 1;
+    if (index != last)
+    {
+        place(index, heap_[last]);
+        heap_.pop_back();
+        // 末尾元素补位后，可能需要上浮也可能需要下沉
+        if (index > 0 && less(heap_[index], heap_[(index - 1) / 2]))
+        {
+            siftUp(index);
+        }
+        else
+        {
+            siftDown(index);
+        }
+    }
+    else
+    {
+        heap_.pop_back();
+    }
+}
+
+void TimerQueue::siftUp(size_t index)
+{
+    Entry entry = heap_[index];
+    while (index > 0)
+    {
+        size_t parent = (index - 1) / 2;
+        if (!less(entry, heap_[parent]))
+        {
+            break;
+        }
+        place(index, heap_[parent]);
+        index = parent;
+    }
+    place(index, entry);
+}
+
+void TimerQueue::siftDown(size_t index)
+{
+    Entry entry = heap_[index];
+    size_t size = heap_.size();
+    while (true)
+    {
+        size_t child = index * 2 + 1;
+        if (child >= size)
+        {
+            break;
+        }
+        if (child + 1 < size && less(heap_[child + 1], heap_[child]))
+        {
+            ++child;
+        }
+        if (!less(heap_[child], entry))
+        {
+            break;
+        }
+        place(index, heap_[child]);
+        index = child;
+    }
+    place(index, entry);
+}
+
+// 到期时间相同时按创建顺序，保证同一时刻的定时器先加先执行
+bool TimerQueue::less(const Entry &lhs, const Entry &rhs) const
+{
+    if (lhs.when == rhs.when)
+    {
+        return lhs.timer->sequence() < rhs.timer->sequence();
+    }
+    return lhs.when < rhs.when;
+}
+
+void TimerQueue::place(size_t index, const Entry &entry)
+{
+    heap_[index] = entry;
+    entry.timer->setHeapIndex(static_cast<int>(index));
+}
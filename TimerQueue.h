@@ -0,0 +1,65 @@
+// 定时器队列，每个EventLoop一个，用timerfd把定时事件接入poller
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+/**
+ * 定时器按到期时间组织成最小堆，堆顶就是timerfd下一次要触发的时间
+ * 堆元素内联保存到期时间，上浮下沉比较时只访问连续的vector，不需要解引用Timer
+ * Timer记录自己在堆中的下标，cancel是O(log n)
+*/
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 添加定时器，线程安全，可以跨线程调用
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    // 取消定时器，线程安全
+    void cancel(TimerId timerId);
+
+private:
+    struct Entry
+    {
+        Timestamp when;
+        Timer *timer;
+    };
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd可读，处理所有到期的定时器
+    void handleRead();
+    // 重新设置timerfd的到期时间
+    void resetTimerfd(Timestamp expiration);
+
+    // 最小堆操作，insert返回堆顶是否发生变化
+    bool insert(Timer *timer);
+    void removeAt(size_t index);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    bool less(const Entry &lhs, const Entry &rhs) const;
+    void place(size_t index, const Entry &entry);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    std::vector<Entry> heap_; // 未到期的定时器
+    std::unordered_map<int64_t, Timer*> activeTimers_; // sequence -> timer，校验TimerId是否还有效
+    std::vector<Timer*> expired_; // handleRead复用，避免每次分配
+
+    bool callingExpiredTimers_; // 正在执行到期定时器的回调
+    std::unordered_set<int64_t> cancelingTimers_; // 回调执行期间被取消的定时器
+};
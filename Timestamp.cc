@@ -1,6 +1,11 @@
 #include "Timestamp.h"
 
 #include <time.h>
+#include <stdio.h>
+
+// 每个线程缓存上一次格式化的秒，同一秒内的时间只需要拼接微秒部分，不用每次调用localtime
+static __thread time_t t_lastSecond = -1;
+static __thread char t_secondPrefix[80]; // 各字段都取int的极值时也放得下，正常只用19个字节
 
 Timestamp::Timestamp():microSecondsSinceEpoch_(0) {}
 
@@ -8,22 +13,61 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
     : microSecondsSinceEpoch_(microSecondsSinceEpoch)
     {}
 
+static Timestamp fromClock(clockid_t clock)
+{
+    struct timespec ts;
+    ::clock_gettime(clock, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond
+                     + ts.tv_nsec / 1000);
+}
+
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+    return fromClock(CLOCK_REALTIME);
+}
+
+Timestamp Timestamp::nowCoarse()
+{
+    return fromClock(CLOCK_REALTIME_COARSE);
+}
+
+int Timestamp::formatTo(char *buf, size_t size, bool showMicroseconds) const
+{
+    time_t seconds = secondsSinceEpoch();
+    if (seconds != t_lastSecond)
+    {
+        struct tm tm_time;
+        ::localtime_r(&seconds, &tm_time); // localtime不是线程安全的
+        snprintf(t_secondPrefix, sizeof t_secondPrefix,
+            "%4d/%02d/%02d %02d:%02d:%02d",
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
+        t_lastSecond = seconds;
+    }
+
+    if (showMicroseconds)
+    {
+        int microseconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+        return snprintf(buf, size, "%s.%06d", t_secondPrefix, microseconds);
+    }
+    return snprintf(buf, size, "%s", t_secondPrefix);
 }
 
 std::string Timestamp::toString() const
 {
-    char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d", 
-        tm_time->tm_year + 1900,
-        tm_time->tm_mon + 1,
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec);
+    char buf[64];
+    formatTo(buf, sizeof buf, false);
+    return buf;
+}
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
+{
+    char buf[64];
+    formatTo(buf, sizeof buf, showMicroseconds);
     return buf;
 }
 
@@ -32,4 +76,4 @@ std::string Timestamp::toString() const
 // {
 //     std::cout << Timestamp::now().toString() << std::endl; 
 //     return 0;
-// }
\ No newline at end of file
+// }
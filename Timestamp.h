@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <time.h>
 
 // 时间类
 class Timestamp
@@ -10,8 +11,43 @@ class Timestamp
 public:
     Timestamp(); // 默认
     explicit Timestamp(int64_t microSecondsSinceEpoch); // 带参勾走，显式构造，防止其他行为
-    static Timestamp now(); // 当前时间
-    std::string toString() const; // 转化时间格式
+    static Timestamp now(); // 当前时间，微秒精度，clock_gettime走vDSO不陷入内核
+    static Timestamp nowCoarse(); // 粗粒度当前时间（精度为一个时钟节拍，几毫秒），比now()更便宜，用于日志
+    static Timestamp invalid() { return Timestamp(); } // 无效时间
+    std::string toString() const; // 转化时间格式 2024/01/01 12:00:00
+    std::string toFormattedString(bool showMicroseconds = true) const; // 2024/01/01 12:00:00.123456
+    // 格式化到调用者的缓冲，不分配内存，返回写入的长度；日志的热路径使用
+    int formatTo(char *buf, size_t size, bool showMicroseconds = false) const;
+
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    time_t secondsSinceEpoch() const
+    { return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond); }
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
 private:
-    int64_t microSecondsSinceEpoch_; // 毫秒
-};
\ No newline at end of file
+    int64_t microSecondsSinceEpoch_; // 微秒
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 两个时间相差的微秒数，用于测量延迟
+inline int64_t timeDifferenceMicros(Timestamp high, Timestamp low)
+{
+    return high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+}
+
+// 时间戳加上seconds秒，定时器计算到期时间使用
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
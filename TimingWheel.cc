@@ -0,0 +1,157 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+
+#include <math.h>
+
+TimingWheel::Entry::Entry()
+    : prev_(this)
+    , next_(this)
+    , wheel_(nullptr)
+    , deadline_(0)
+    , visitTick_(0)
+    , describe_(nullptr)
+    , owner_(nullptr)
+{
+}
+
+TimingWheel::Entry::~Entry()
+{
+    cancel();
+}
+
+void TimingWheel::Entry::cancel()
+{
+    if (wheel_)
+    {
+        wheel_->remove(this);
+    }
+}
+
+// 槽数向上取整到2的幂
+static uint64_t roundUpSlots(int numSlots)
+{
+    uint64_t n = 1;
+    while (n < static_cast<uint64_t>(numSlots))
+    {
+        n <<= 1;
+    }
+    return n;
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds, int numSlots)
+    : loop_(loop)
+    , tickSeconds_(tickSeconds)
+    , mask_(roundUpSlots(numSlots) - 1)
+    , slots_(mask_ + 1)
+    , currentTick_(0)
+    , size_(0)
+{
+    tickTimer_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTick, this));
+}
+
+TimingWheel::~TimingWheel()
+{
+    loop_->cancel(tickTimer_);
+    // 剩下的Entry属于各自的连接，只需要断开和时间轮的关系
+    for (Entry &head : slots_)
+    {
+        while (head.next_ != &head)
+        {
+            Entry *entry = head.next_;
+            unlink(entry);
+            entry->wheel_ = nullptr;
+        }
+    }
+}
+
+void TimingWheel::touch(Entry *entry, double timeoutSeconds)
+{
+    // 当前tick已经走过了一部分，多加一格，保证实际超时不短于timeoutSeconds
+    uint64_t ticks = static_cast<uint64_t>(::ceil(timeoutSeconds / tickSeconds_)) + 1;
+    entry->deadline_ = currentTick_ + ticks;
+
+    if (entry->wheel_ == nullptr)
+    {
+        entry->wheel_ = this;
+        ++size_;
+        link(entry);
+    }
+    else if (entry->deadline_ < entry->visitTick_)
+    {
+        // 超时缩短了，原来的槽来不及，需要换槽；超时延长则什么都不用做
+        unlink(entry);
+        link(entry);
+    }
+}
+
+void TimingWheel::remove(Entry *entry)
+{
+    if (entry->wheel_ == this)
+    {
+        unlink(entry);
+        entry->wheel_ = nullptr;
+        --size_;
+    }
+}
+
+void TimingWheel::onTick()
+{
+    ++currentTick_;
+    Entry &head = slots_[currentTick_ & mask_];
+    if (head.next_ == &head)
+    {
+        return;
+    }
+
+    // 把整个槽摘到局部链表上，回调里touch回来的Entry会挂到新槽，不会在本轮被重复处理
+    Entry pending;
+    pending.next_ = head.next_;
+    pending.prev_ = head.prev_;
+    pending.next_->prev_ = &pending;
+    pending.prev_->next_ = &pending;
+    head.next_ = head.prev_ = &head;
+
+    // 每次都取表头，回调可能摘除同一批里的其他Entry（比如连接关闭时摘除它的读超时）
+    while (pending.next_ != &pending)
+    {
+        Entry *entry = pending.next_;
+        unlink(entry);
+        if (entry->deadline_ > currentTick_) // 期间被touch过，还没到期
+        {
+            link(entry);
+            continue;
+        }
+        entry->wheel_ = nullptr;
+        --size_;
+        if (entry->callback_)
+        {
+            // 回调里Entry可能被销毁，先取出描述
+            DescribeCallback describe = entry->describe_;
+            const void *owner = entry->owner_;
+            Timestamp start = loop_->slowCallbackStart();
+            entry->callback_();
+            loop_->checkSlowCallback(EventLoop::kTimeout, describe, owner, -1, start);
+        }
+    }
+}
+
+// 挂到deadline_对应的槽上，记录这个槽下一次被处理的tick
+void TimingWheel::link(Entry *entry)
+{
+    uint64_t delta = entry->deadline_ - currentTick_;
+    uint64_t steps = delta & mask_;
+    entry->visitTick_ = currentTick_ + (steps == 0 ? mask_ + 1 : steps);
+
+    Entry &head = slots_[entry->deadline_ & mask_];
+    entry->prev_ = head.prev_;
+    entry->next_ = &head;
+    head.prev_->next_ = entry;
+    head.prev_ = entry;
+}
+
+void TimingWheel::unlink(Entry *entry)
+{
+    entry->prev_->next_ = entry->next_;
+    entry->next_->prev_ = entry->prev_;
+    entry->prev_ = entry->next_ = entry;
+}
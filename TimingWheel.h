@@ -0,0 +1,76 @@
+// 时间轮，每个EventLoop一个，管理大量连接的空闲超时和读超时
+#pragma once
+
+#include "noncopyable.h"
+#include "TimerId.h"
+#include "Callbacks.h"
+
+#include <functional>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class EventLoop;
+
+/**
+ * 哈希时间轮：slots_个槽组成环，每tick_秒前进一格，处理当前槽里的Entry
+ * Entry是侵入式双向链表节点，嵌在TcpConnection里，挂入/摘除都是O(1)，不需要分配内存
+ * touch只更新Entry的到期tick，Entry留在原来的槽里（惰性），等该槽到期时发现还没到点，
+ * 再挂到真正到期的槽上；到期时间超过一圈的Entry每转一圈被检查一次，相当于多层时间轮的降级
+ * 所以连接每次读写刷新超时都只是一次赋值，没有链表操作
+*/
+class TimingWheel : noncopyable
+{
+public:
+    using Callback = std::function<void()>;
+
+    class Entry : noncopyable
+    {
+    public:
+        Entry();
+        ~Entry();
+
+        // 到期回调，在loop线程执行，执行前Entry已经从时间轮摘除
+        void setCallback(Callback cb) { callback_ = std::move(cb); }
+        // 慢回调报告里的描述，owner要在回调返回后仍然有效（TcpConnection的销毁总是排在之后的回调里）
+        void setDescription(DescribeCallback describe, const void *owner) { describe_ = describe; owner_ = owner; }
+        bool linked() const { return wheel_ != nullptr; }
+        // 从时间轮摘除，不再触发
+        void cancel();
+    private:
+        friend class TimingWheel;
+
+        Entry *prev_;
+        Entry *next_;
+        TimingWheel *wheel_; // 所在的时间轮，nullptr表示没有挂在任何槽上
+        uint64_t deadline_; // 到期的tick
+        uint64_t visitTick_; // 所在的槽下一次被处理的tick
+        Callback callback_;
+        DescribeCallback describe_;
+        const void *owner_;
+    };
+
+    explicit TimingWheel(EventLoop *loop, double tickSeconds = 1.0, int numSlots = 64);
+    ~TimingWheel();
+
+    // 设置或刷新entry的超时为timeoutSeconds秒后，O(1)，只能在loop线程调用
+    void touch(Entry *entry, double timeoutSeconds);
+    // 摘除entry，O(1)
+    void remove(Entry *entry);
+
+    size_t size() const { return size_; }
+    double tickSeconds() const { return tickSeconds_; }
+private:
+    // 每个tick执行，批量处理当前槽
+    void onTick();
+    void link(Entry *entry);
+    static void unlink(Entry *entry);
+
+    EventLoop *loop_;
+    const double tickSeconds_;
+    const uint64_t mask_; // 槽数是2的幂，取模用与运算
+    std::vector<Entry> slots_; // 每个槽是一个带哨兵的循环链表，哨兵就是slots_[i]本身
+    uint64_t currentTick_;
+    size_t size_;
+    TimerId tickTimer_;
+};
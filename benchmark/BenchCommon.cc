@@ -0,0 +1,137 @@
+#include "BenchCommon.h"
+#include "Logger.h"
+
+#include <sys/uio.h>
+
+ResultWriter::ResultWriter(const BenchOptions &options)
+    : options_(options)
+    , sink_(options.out)
+{
+}
+
+ResultWriter::~ResultWriter()
+{
+}
+
+void ResultWriter::emit(BenchResult result, const EventLoop *serverLoop)
+{
+    result.add("server_mode", std::string(options_.edgeTriggered ? "et" : "lt"));
+    result.add("acceptor", std::string(options_.reusePortPerLoop ? "reuseport_per_loop" : "single"));
+    result.addPoller(serverLoop);
+    sink_.emit(result);
+}
+
+void echoBack(const TcpConnectionPtr &conn, Buffer *buf)
+{
+    struct iovec vec;
+    vec.iov_base = const_cast<char*>(buf->peek());
+    vec.iov_len = buf->readableBytes();
+    conn->sendv(&vec, 1);
+    buf->retrieveAll();
+}
+
+TcpServer::Option serverOption(const BenchOptions &options)
+{
+    return options.reusePortPerLoop ? TcpServer::kReusePortPerLoop : TcpServer::kReusePort;
+}
+
+void configureServer(TcpServer &server, const BenchOptions &options, int loops)
+{
+    server.setThreadNum(loops);
+    server.setEdgeTriggered(options.edgeTriggered);
+    server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        echoBack(conn, buf);
+    });
+}
+
+ClientGroup::ClientGroup(EventLoop *baseLoop, const InetAddress &serverAddr,
+                         int clientLoops, int clients, const std::string &name)
+    : baseLoop_(baseLoop)
+    , pool_(baseLoop, name)
+    , retry_(false)
+    , connected_(0)
+{
+    pool_.setThreadNum(clientLoops);
+    pool_.start();
+    std::vector<EventLoop*> loops = pool_.getAllLoops();
+    for (int i = 0; i < clients; ++i)
+    {
+        char clientName[64];
+        snprintf(clientName, sizeof clientName, "%s-%d", name.c_str(), i);
+        TcpClient *client = new TcpClient(loops[i % loops.size()], serverAddr, clientName);
+        client->setTcpNoDelay(true);
+        client->setConnectionCallback(
+            std::bind(&ClientGroup::onConnection, this, i, std::placeholders::_1));
+        client->setMessageCallback([this, i](const TcpConnectionPtr &conn, Buffer *buf, Timestamp time) {
+            messageCallback_(i, conn, buf, time);
+        });
+        clients_.push_back(std::unique_ptr<TcpClient>(client));
+    }
+}
+
+ClientGroup::~ClientGroup()
+{
+    clients_.clear();
+}
+
+void ClientGroup::start()
+{
+    for (auto &client : clients_)
+    {
+        if (retry_)
+        {
+            client->enableRetry();
+        }
+        client->connect();
+    }
+}
+
+void ClientGroup::onConnection(int index, const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        connected_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        connected_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (connectionCallback_)
+    {
+        connectionCallback_(index, conn);
+    }
+}
+
+void ClientGroup::shutdown(double timeout, std::function<void()> done)
+{
+    for (auto &client : clients_)
+    {
+        client->stop();
+        client->disconnect();
+    }
+    shutdownDeadline_ = addTime(Timestamp::now(), timeout);
+    shutdownDone_ = std::move(done);
+    shutdownTimer_ = baseLoop_->runEvery(0.01, std::bind(&ClientGroup::checkShutdown, this));
+}
+
+void ClientGroup::checkShutdown()
+{
+    if (connected() > 0 && Timestamp::now() < shutdownDeadline_)
+    {
+        return;
+    }
+    if (connected() > 0)
+    {
+        LOG_ERROR("ClientGroup::shutdown %d connections still open \n", connected());
+    }
+    baseLoop_->cancel(shutdownTimer_);
+    std::function<void()> done;
+    done.swap(shutdownDone_);
+    done();
+}
@@ -0,0 +1,98 @@
+// 网络压测的公共部分：参数、结果输出、客户端连接组
+#pragma once
+
+#include "BenchResult.h"
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoopThreadPool.h"
+#include "noncopyable.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct BenchOptions
+{
+    double seconds = 2.0; // 每一项测量的时长，不含预热
+    double warmup = 0.5;
+    uint16_t port = 9981;
+    int connections = 64; // pingpong的连接数
+    int latencyConnections = 16; // 时延测试并发的请求数
+    int churnConcurrency = 32; // 建连测试同时进行的连接数
+    std::vector<int> loops = {1, 2, 4};
+    std::vector<size_t> sizes = {64, 1024, 16384};
+    bool edgeTriggered = false; // 服务端用边缘触发
+    bool reusePortPerLoop = false; // 服务端用TcpServer::kReusePortPerLoop
+    std::string out; // 结果追加写入的文件，空表示只输出到stdout
+};
+
+class ResultWriter : noncopyable
+{
+public:
+    explicit ResultWriter(const BenchOptions &options);
+    ~ResultWriter();
+
+    // 加上公共字段（服务端配置、serverLoop的poller）后输出
+    void emit(BenchResult result, const EventLoop *serverLoop);
+
+private:
+    const BenchOptions &options_;
+    ResultSink sink_;
+};
+
+// 把buf里的数据原样发回，在loop线程里直接writev，不拼接成string
+void echoBack(const TcpConnectionPtr &conn, Buffer *buf);
+
+// 按options配置测试用的回显服务端
+void configureServer(TcpServer &server, const BenchOptions &options, int loops);
+TcpServer::Option serverOption(const BenchOptions &options);
+
+/**
+ * 分布在clientLoops个loop上的一组TcpClient，回调带上客户端下标，场景据此保存每个连接的状态
+ * 在baseLoop线程创建和析构；回调在各客户端的loop线程执行
+*/
+class ClientGroup : noncopyable
+{
+public:
+    using ConnectionCallback = std::function<void(int index, const TcpConnectionPtr&)>;
+    using MessageCallback = std::function<void(int index, const TcpConnectionPtr&, Buffer*, Timestamp)>;
+
+    ClientGroup(EventLoop *baseLoop, const InetAddress &serverAddr,
+                int clientLoops, int clients, const std::string &name);
+    ~ClientGroup();
+
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    // 连接断开后自动重连，需要在start之前设置
+    void enableRetry() { retry_ = true; }
+
+    void start();
+    int connected() const { return connected_.load(std::memory_order_relaxed); }
+    size_t size() const { return clients_.size(); }
+
+    // 停止重连并关闭所有连接，全部断开（最多等待timeout秒）后在baseLoop线程调用done
+    void shutdown(double timeout, std::function<void()> done);
+
+private:
+    void onConnection(int index, const TcpConnectionPtr &conn);
+    void checkShutdown();
+
+    EventLoop *baseLoop_;
+    EventLoopThreadPool pool_;
+    std::vector<std::unique_ptr<TcpClient>> clients_; // 先于pool_析构
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    bool retry_;
+    std::atomic_int connected_;
+
+    Timestamp shutdownDeadline_;
+    std::function<void()> shutdownDone_;
+    TimerId shutdownTimer_;
+};
+
+// 各场景，结果通过writer输出
+void runPingpong(const BenchOptions &options, ResultWriter &writer);
+void runChurn(const BenchOptions &options, ResultWriter &writer);
+void runLatency(const BenchOptions &options, ResultWriter &writer);
@@ -0,0 +1,85 @@
+#include "BenchResult.h"
+#include "Logger.h"
+#include "EventLoop.h"
+
+#include <algorithm>
+
+BenchResult::BenchResult(const std::string &bench)
+    : json_("{\"bench\":\"" + bench + "\"")
+{
+}
+
+BenchResult& BenchResult::add(const char *key, int64_t value)
+{
+    char buf[96];
+    snprintf(buf, sizeof buf, ",\"%s\":%lld", key, static_cast<long long>(value));
+    json_ += buf;
+    return *this;
+}
+
+BenchResult& BenchResult::add(const char *key, double value)
+{
+    char buf[96];
+    snprintf(buf, sizeof buf, ",\"%s\":%.3f", key, value);
+    json_ += buf;
+    return *this;
+}
+
+BenchResult& BenchResult::add(const char *key, const std::string &value)
+{
+    // 值都是程序自己生成的标识，不含需要转义的字符
+    json_ += ",\"";
+    json_ += key;
+    json_ += "\":\"";
+    json_ += value;
+    json_ += "\"";
+    return *this;
+}
+
+int64_t percentile(const std::vector<int64_t> &sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(q * sorted.size());
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+BenchResult& BenchResult::addPoller(const EventLoop *loop)
+{
+    return add("poller", std::string(loop->pollerName()));
+}
+
+ResultSink::ResultSink(const std::string &path)
+    : file_(nullptr)
+{
+    if (!path.empty())
+    {
+        file_ = ::fopen(path.c_str(), "ae");
+        if (file_ == nullptr)
+        {
+            LOG_FATAL("bench: cannot open %s \n", path.c_str());
+        }
+    }
+}
+
+ResultSink::~ResultSink()
+{
+    if (file_)
+    {
+        ::fclose(file_);
+    }
+}
+
+void ResultSink::emit(const BenchResult &result)
+{
+    std::string line = result.line();
+    ::printf("%s\n", line.c_str());
+    ::fflush(stdout);
+    if (file_)
+    {
+        ::fprintf(file_, "%s\n", line.c_str());
+        ::fflush(file_);
+    }
+}
@@ -0,0 +1,44 @@
+// 压测结果：每条结果一行JSON，输出到stdout，可以同时追加到文件
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+class EventLoop;
+
+class BenchResult
+{
+public:
+    explicit BenchResult(const std::string &bench);
+
+    BenchResult& add(const char *key, int64_t value);
+    BenchResult& add(const char *key, double value);
+    BenchResult& add(const char *key, const std::string &value);
+    // "poller"字段：loop实际创建的poller，io_uring不可用退回epoll时如实记录
+    BenchResult& addPoller(const EventLoop *loop);
+
+    std::string line() const { return json_ + "}"; }
+
+private:
+    std::string json_;
+};
+
+// 已排序样本的分位数，q取0~1，样本为空时返回0
+int64_t percentile(const std::vector<int64_t> &sorted, double q);
+
+class ResultSink : noncopyable
+{
+public:
+    // path为空时只输出到stdout
+    explicit ResultSink(const std::string &path);
+    ~ResultSink();
+
+    void emit(const BenchResult &result);
+
+private:
+    FILE *file_;
+};
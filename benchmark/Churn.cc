@@ -0,0 +1,61 @@
+// 建连速率：客户端连上之后服务端立即关闭，客户端断开后马上重连，统计完成的连接数
+#include "BenchCommon.h"
+
+#include <atomic>
+
+static void runChurnOnce(const BenchOptions &options, ResultWriter &writer, int loops)
+{
+    EventLoop loop;
+    InetAddress serverAddr(options.port);
+    TcpServer server(&loop, serverAddr, "churn", serverOption(options));
+    configureServer(server, options, loops);
+    // 由服务端先关闭，TIME_WAIT留在服务端，客户端的临时端口不会被耗尽
+    server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            conn->shutdown();
+        }
+    });
+    server.start();
+
+    std::atomic<int64_t> completed(0);
+    ClientGroup clients(&loop, serverAddr, loops, options.churnConcurrency, "churn-client");
+    clients.enableRetry(); // TcpClient在连接断开后立即重连
+    clients.setConnectionCallback([&completed](int, const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+        {
+            completed.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    clients.setMessageCallback([](int, const TcpConnectionPtr&, Buffer *buf, Timestamp) {
+        buf->retrieveAll();
+    });
+    clients.start();
+
+    int64_t startCompleted = 0;
+    Timestamp startTime;
+    loop.runAfter(options.warmup, [&]() {
+        startCompleted = completed.load(std::memory_order_relaxed);
+        startTime = Timestamp::now();
+    });
+    loop.runAfter(options.warmup + options.seconds, [&]() {
+        double seconds = timeDifferenceMicros(Timestamp::now(), startTime) / 1e6;
+        int64_t count = completed.load(std::memory_order_relaxed) - startCompleted;
+        writer.emit(BenchResult("churn")
+            .add("loops", static_cast<int64_t>(loops))
+            .add("concurrency", static_cast<int64_t>(options.churnConcurrency))
+            .add("seconds", seconds)
+            .add("connections", count)
+            .add("connections_per_sec", count / seconds), &loop);
+        clients.shutdown(2.0, std::bind(&EventLoop::quit, &loop));
+    });
+    loop.loop();
+}
+
+void runChurn(const BenchOptions &options, ResultWriter &writer)
+{
+    for (int loops : options.loops)
+    {
+        runChurnOnce(options, writer, loops);
+    }
+}
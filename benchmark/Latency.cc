@@ -0,0 +1,113 @@
+// 请求响应时延：每个连接同时只有一个请求在途，收齐回显后记录往返时间再发下一个
+#include "BenchCommon.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+
+// 一个连接的状态，只在它所在的客户端loop里访问
+struct LatencyClient
+{
+    Timestamp sentAt;
+    size_t received = 0;
+    std::vector<int64_t> samples; // 往返时间，微秒
+};
+
+} // namespace
+
+static void runLatencyOnce(const BenchOptions &options, ResultWriter &writer, int loops, size_t size)
+{
+    EventLoop loop;
+    InetAddress serverAddr(options.port);
+    TcpServer server(&loop, serverAddr, "latency", serverOption(options));
+    configureServer(server, options, loops);
+    server.start();
+
+    const int connections = options.latencyConnections;
+    std::vector<LatencyClient> states(connections);
+    std::atomic_bool recording(false);
+    const std::string request(size, 'x');
+    double seconds = 0;
+
+    {
+        ClientGroup clients(&loop, serverAddr, loops, connections, "latency-client");
+        clients.setConnectionCallback([&](int index, const TcpConnectionPtr &conn) {
+            if (conn->connected())
+            {
+                states[index].sentAt = Timestamp::now();
+                conn->send(request);
+            }
+        });
+        clients.setMessageCallback([&](int index, const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            LatencyClient &state = states[index];
+            state.received += buf->readableBytes();
+            buf->retrieveAll();
+            if (state.received < size)
+            {
+                return;
+            }
+            Timestamp now = Timestamp::now();
+            if (recording.load(std::memory_order_relaxed))
+            {
+                state.samples.push_back(timeDifferenceMicros(now, state.sentAt));
+            }
+            state.received -= size;
+            state.sentAt = now;
+            conn->send(request);
+        });
+        clients.start();
+
+        Timestamp startTime;
+        loop.runAfter(options.warmup, [&]() {
+            recording = true;
+            startTime = Timestamp::now();
+        });
+        loop.runAfter(options.warmup + options.seconds, [&]() {
+            recording = false;
+            seconds = timeDifferenceMicros(Timestamp::now(), startTime) / 1e6;
+            clients.shutdown(2.0, std::bind(&EventLoop::quit, &loop));
+        });
+        loop.loop();
+    } // 客户端loop线程都已退出，可以读取各连接的样本
+
+    std::vector<int64_t> samples;
+    for (const LatencyClient &state : states)
+    {
+        samples.insert(samples.end(), state.samples.begin(), state.samples.end());
+    }
+    std::sort(samples.begin(), samples.end());
+    double mean = 0;
+    for (int64_t sample : samples)
+    {
+        mean += sample;
+    }
+    mean = samples.empty() ? 0 : mean / samples.size();
+
+    writer.emit(BenchResult("latency")
+        .add("loops", static_cast<int64_t>(loops))
+        .add("connections", static_cast<int64_t>(connections))
+        .add("size", static_cast<int64_t>(size))
+        .add("seconds", seconds)
+        .add("requests", static_cast<int64_t>(samples.size()))
+        .add("requests_per_sec", seconds > 0 ? samples.size() / seconds : 0.0)
+        .add("mean_us", mean)
+        .add("p50_us", percentile(samples, 0.50))
+        .add("p90_us", percentile(samples, 0.90))
+        .add("p99_us", percentile(samples, 0.99))
+        .add("p999_us", percentile(samples, 0.999))
+        .add("max_us", samples.empty() ? int64_t(0) : samples.back()), &loop);
+}
+
+void runLatency(const BenchOptions &options, ResultWriter &writer)
+{
+    for (int loops : options.loops)
+    {
+        for (size_t size : options.sizes)
+        {
+            runLatencyOnce(options, writer, loops, size);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+// 核心原语的微基准：不经过网络，结果足够稳定，可以作为性能变更的门禁
+#pragma once
+
+#include "BenchResult.h"
+
+#include <chrono>
+#include <string>
+#include <stdint.h>
+
+struct MicroOptions
+{
+    double seconds = 0.5; // 每一项测量的时长
+    int maxProducers = 4; // queueInLoop测试的生产者线程数从1翻倍到这个值
+    std::string out;
+};
+
+// 单调时钟的纳秒数
+inline int64_t nowNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * 反复执行body直到超过seconds秒，body每次做batch个操作
+ * 返回平均每个操作的纳秒数，*ops为执行的操作总数
+*/
+template <typename F>
+double measureNanosPerOp(double seconds, int64_t batch, F body, int64_t *ops)
+{
+    const int64_t budget = static_cast<int64_t>(seconds * 1e9);
+    int64_t count = 0;
+    int64_t start = nowNanos();
+    int64_t elapsed = 0;
+    do
+    {
+        for (int64_t i = 0; i < batch; ++i)
+        {
+            body();
+        }
+        count += batch;
+        elapsed = nowNanos() - start;
+    } while (elapsed < budget);
+    *ops = count;
+    return static_cast<double>(elapsed) / count;
+}
+
+void runBufferBenches(const MicroOptions &options, ResultSink &sink);
+void runLoopBenches(const MicroOptions &options, ResultSink &sink);
@@ -0,0 +1,160 @@
+// Buffer的追加/取出、扩容和整理、readFd
+#include "MicroBench.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 防止编译器把结果没有用到的操作优化掉
+static volatile size_t g_sink;
+
+// 稳定状态下的追加和取出，缓冲不扩容也不移动数据
+static void benchAppendRetrieve(const MicroOptions &options, ResultSink &sink, size_t size)
+{
+    Buffer buf;
+    std::string data(size, 'x');
+    int64_t ops = 0;
+    double ns = measureNanosPerOp(options.seconds, 1024, [&]() {
+        buf.append(data.data(), size);
+        g_sink = buf.readableBytes();
+        buf.retrieve(size);
+    }, &ops);
+    sink.emit(BenchResult("buffer_append_retrieve")
+        .add("size", static_cast<int64_t>(size))
+        .add("ops", ops)
+        .add("ns_per_op", ns)
+        .add("gib_per_sec", size / ns));
+}
+
+// 新缓冲按64字节一块写满total字节，makeSpace反复扩容
+static void benchGrowth(const MicroOptions &options, ResultSink &sink, size_t total)
+{
+    const size_t chunk = 64;
+    std::string data(chunk, 'x');
+    int64_t reallocs = 0;
+    int64_t ops = 0;
+    double ns = measureNanosPerOp(options.seconds, 16, [&]() {
+        Buffer buf;
+        size_t capacity = buf.internalCapacity();
+        for (size_t written = 0; written < total; written += chunk)
+        {
+            buf.append(data.data(), chunk);
+            if (buf.internalCapacity() != capacity)
+            {
+                capacity = buf.internalCapacity();
+                ++reallocs;
+            }
+        }
+        g_sink = buf.readableBytes();
+    }, &ops);
+    sink.emit(BenchResult("buffer_growth")
+        .add("chunk", static_cast<int64_t>(chunk))
+        .add("total", static_cast<int64_t>(total))
+        .add("ops", ops)
+        .add("ns_per_fill", ns)
+        .add("ns_per_byte", ns / total)
+        .add("reallocs_per_fill", static_cast<double>(reallocs) / ops));
+}
+
+// 一直留着backlog字节没取走，写到末尾时makeSpace把数据挪回开头
+static void benchCompaction(const MicroOptions &options, ResultSink &sink, size_t backlog)
+{
+    const size_t chunk = 1024;
+    Buffer buf;
+    std::string data(backlog, 'x');
+    buf.append(data.data(), backlog);
+    int64_t ops = 0;
+    double ns = measureNanosPerOp(options.seconds, 1024, [&]() {
+        buf.append(data.data(), chunk);
+        buf.retrieve(chunk);
+    }, &ops);
+    g_sink = buf.internalCapacity();
+    sink.emit(BenchResult("buffer_compaction")
+        .add("chunk", static_cast<int64_t>(chunk))
+        .add("backlog", static_cast<int64_t>(backlog))
+        .add("ops", ops)
+        .add("ns_per_op", ns)
+        .add("capacity", static_cast<int64_t>(buf.internalCapacity())));
+}
+
+// 在socketpair上写入chunk字节再读出，对比Buffer::readFd和直接read
+static void benchReadFd(const MicroOptions &options, ResultSink &sink, size_t chunk)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+        LOG_FATAL("microbench socketpair err:%d \n", errno);
+    }
+    int sndbuf = static_cast<int>(chunk * 4);
+    ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+    std::string data(chunk, 'x');
+
+    Buffer buf;
+    int64_t readFdOps = 0;
+    double readFdNs = measureNanosPerOp(options.seconds, 64, [&]() {
+        ::write(fds[0], data.data(), chunk);
+        size_t got = 0;
+        while (got < chunk)
+        {
+            int savedErrno = 0;
+            ssize_t n = buf.readFd(fds[1], &savedErrno, chunk);
+            if (n <= 0)
+            {
+                break;
+            }
+            got += n;
+        }
+        g_sink = buf.readableBytes();
+        buf.retrieveAll();
+    }, &readFdOps);
+
+    std::string plain(chunk, '\0');
+    int64_t readOps = 0;
+    double readNs = measureNanosPerOp(options.seconds, 64, [&]() {
+        ::write(fds[0], data.data(), chunk);
+        size_t got = 0;
+        while (got < chunk)
+        {
+            ssize_t n = ::read(fds[1], &plain[0], chunk);
+            if (n <= 0)
+            {
+                break;
+            }
+            got += n;
+        }
+        g_sink = got;
+    }, &readOps);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    sink.emit(BenchResult("buffer_readfd")
+        .add("chunk", static_cast<int64_t>(chunk))
+        .add("ops", readFdOps)
+        .add("ns_per_op", readFdNs)
+        .add("read_baseline_ns_per_op", readNs)
+        .add("overhead_ns", readFdNs - readNs));
+}
+
+void runBufferBenches(const MicroOptions &options, ResultSink &sink)
+{
+    for (size_t size : {16, 256, 4096})
+    {
+        benchAppendRetrieve(options, sink, size);
+    }
+    for (size_t total : {4096, 65536, 1048576})
+    {
+        benchGrowth(options, sink, total);
+    }
+    for (size_t backlog : {512, 3072, 16384})
+    {
+        benchCompaction(options, sink, backlog);
+    }
+    for (size_t chunk : {512, 16384, 65536})
+    {
+        benchReadFd(options, sink, chunk);
+    }
+}
@@ -0,0 +1,177 @@
+// EventLoop::queueInLoop跨线程投递到执行的时延，poller返回加Channel分发的开销
+#include "MicroBench.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Channel.h"
+#include "Thread.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// 在loop线程执行func并等待它完成
+static void runSync(EventLoop *loop, const std::function<void()> &func)
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    loop->runInLoop([&]() {
+        func();
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cond.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!done)
+    {
+        cond.wait(lock);
+    }
+}
+
+namespace
+{
+
+// 一个生产者在途的任务数，不超过window
+struct Producer
+{
+    std::atomic_int inflight{0};
+    int64_t posted = 0;
+};
+
+} // namespace
+
+/**
+ * producers个线程向同一个loop投递任务，每个生产者最多window个任务在途
+ * window为1时测的是唤醒时延，window大时测的是有排队时的吞吐和时延
+*/
+static void benchQueueInLoop(const MicroOptions &options, ResultSink &sink, EventLoop *loop,
+                             int producers, int window)
+{
+    std::vector<int64_t> samples; // 只在loop线程写，生产者都结束后再读
+    runSync(loop, [&samples]() { samples.reserve(1 << 20); });
+
+    std::vector<std::unique_ptr<Producer>> states;
+    std::vector<std::unique_ptr<Thread>> threads;
+    const int64_t start = nowNanos();
+    const int64_t deadline = start + static_cast<int64_t>(options.seconds * 1e9);
+    for (int i = 0; i < producers; ++i)
+    {
+        states.emplace_back(new Producer);
+        Producer *state = states.back().get();
+        std::vector<int64_t> *out = &samples;
+        threads.emplace_back(new Thread([loop, state, out, window, deadline]() {
+            while (nowNanos() < deadline)
+            {
+                if (state->inflight.load(std::memory_order_acquire) >= window)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                state->inflight.fetch_add(1, std::memory_order_relaxed);
+                ++state->posted;
+                int64_t stamp = nowNanos();
+                loop->queueInLoop([stamp, state, out]() {
+                    out->push_back(nowNanos() - stamp);
+                    state->inflight.fetch_sub(1, std::memory_order_release);
+                });
+            }
+        }, "producer"));
+        threads.back()->start();
+    }
+
+    int64_t posted = 0;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads[i]->join();
+        posted += states[i]->posted;
+    }
+    // 等在途的任务都执行完，之后samples不会再被loop线程修改
+    runSync(loop, []() {});
+    int64_t elapsed = nowNanos() - start;
+
+    std::sort(samples.begin(), samples.end());
+    sink.emit(BenchResult("queue_in_loop")
+        .add("producers", static_cast<int64_t>(producers))
+        .add("window", static_cast<int64_t>(window))
+        .add("tasks", posted)
+        .add("tasks_per_sec", posted * 1e9 / elapsed)
+        .add("p50_ns", percentile(samples, 0.50))
+        .add("p99_ns", percentile(samples, 0.99))
+        .add("p999_ns", percentile(samples, 0.999))
+        .add("max_ns", samples.empty() ? int64_t(0) : samples.back()));
+}
+
+/**
+ * fds个一直可读的eventfd注册在loop上（水平触发，回调不读取），每轮poll都全部返回
+ * 统计回调执行次数，得到每个活跃fd的poll加分发开销
+*/
+static void benchDispatch(const MicroOptions &options, ResultSink &sink, EventLoop *loop, int fds)
+{
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::atomic<int64_t> dispatched(0);
+    runSync(loop, [&]() {
+        for (int i = 0; i < fds; ++i)
+        {
+            int fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (fd < 0)
+            {
+                LOG_FATAL("microbench eventfd err:%d \n", errno);
+            }
+            Channel *channel = new Channel(loop, fd);
+            channel->setReadCallback([&dispatched](Timestamp) {
+                dispatched.store(dispatched.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            });
+            channel->enableReading();
+            channels.emplace_back(channel);
+        }
+    });
+
+    int64_t start = nowNanos();
+    int64_t before = dispatched.load(std::memory_order_relaxed);
+    ::usleep(static_cast<useconds_t>(options.seconds * 1e6));
+    int64_t count = dispatched.load(std::memory_order_relaxed) - before;
+    int64_t elapsed = nowNanos() - start;
+
+    runSync(loop, [&]() {
+        for (auto &channel : channels)
+        {
+            channel->disableAll();
+            channel->remove();
+            ::close(channel->fd());
+        }
+        channels.clear();
+    });
+
+    sink.emit(BenchResult("poll_dispatch")
+        .add("fds", static_cast<int64_t>(fds))
+        .add("events", count)
+        .add("ns_per_event", count > 0 ? static_cast<double>(elapsed) / count : 0.0)
+        .add("ns_per_iteration", count > 0 ? static_cast<double>(elapsed) * fds / count : 0.0)
+        .addPoller(loop));
+}
+
+void runLoopBenches(const MicroOptions &options, ResultSink &sink)
+{
+    EventLoopThread thread(EventLoopThread::ThreadInitCallback(), "microbench");
+    EventLoop *loop = thread.startLoop();
+
+    for (int window : {1, 64})
+    {
+        for (int producers = 1; producers <= options.maxProducers; producers *= 2)
+        {
+            benchQueueInLoop(options, sink, loop, producers, window);
+        }
+    }
+    for (int fds : {1, 16, 256, 1024})
+    {
+        benchDispatch(options, sink, loop, fds);
+    }
+}
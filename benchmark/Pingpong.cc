@@ -0,0 +1,78 @@
+// pingpong吞吐：每个连接发出一条消息后，双方都把收到的数据原样发回
+#include "BenchCommon.h"
+
+#include <atomic>
+#include <memory>
+
+static void runPingpongOnce(const BenchOptions &options, ResultWriter &writer, int loops, size_t size)
+{
+    EventLoop loop;
+    InetAddress serverAddr(options.port);
+    TcpServer server(&loop, serverAddr, "pingpong", serverOption(options));
+    configureServer(server, options, loops);
+    server.start();
+
+    const int connections = options.connections;
+    // 每个客户端只由自己的loop写，主线程读
+    std::unique_ptr<std::atomic<int64_t>[]> bytesRead(new std::atomic<int64_t>[connections]);
+    for (int i = 0; i < connections; ++i)
+    {
+        bytesRead[i] = 0;
+    }
+    const std::string message(size, 'x');
+
+    ClientGroup clients(&loop, serverAddr, loops, connections, "pingpong-client");
+    clients.setConnectionCallback([&message](int, const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            conn->send(message);
+        }
+    });
+    clients.setMessageCallback([&bytesRead](int index, const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        bytesRead[index].store(bytesRead[index].load(std::memory_order_relaxed) + buf->readableBytes(),
+            std::memory_order_relaxed);
+        echoBack(conn, buf);
+    });
+    clients.start();
+
+    auto totalBytes = [&bytesRead, connections]() {
+        int64_t total = 0;
+        for (int i = 0; i < connections; ++i)
+        {
+            total += bytesRead[i].load(std::memory_order_relaxed);
+        }
+        return total;
+    };
+
+    int64_t startBytes = 0;
+    Timestamp startTime;
+    loop.runAfter(options.warmup, [&]() {
+        startBytes = totalBytes();
+        startTime = Timestamp::now();
+    });
+    loop.runAfter(options.warmup + options.seconds, [&]() {
+        double seconds = timeDifferenceMicros(Timestamp::now(), startTime) / 1e6;
+        int64_t bytes = totalBytes() - startBytes;
+        writer.emit(BenchResult("pingpong")
+            .add("loops", static_cast<int64_t>(loops))
+            .add("connections", static_cast<int64_t>(connections))
+            .add("size", static_cast<int64_t>(size))
+            .add("connected", static_cast<int64_t>(clients.connected()))
+            .add("seconds", seconds)
+            .add("mib_per_sec", bytes / 1048576.0 / seconds)
+            .add("messages_per_sec", bytes / static_cast<double>(size) / seconds), &loop);
+        clients.shutdown(2.0, std::bind(&EventLoop::quit, &loop));
+    });
+    loop.loop();
+}
+
+void runPingpong(const BenchOptions &options, ResultWriter &writer)
+{
+    for (int loops : options.loops)
+    {
+        for (size_t size : options.sizes)
+        {
+            runPingpongOnce(options, writer, loops, size);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+// 核心原语的微基准，每项结果输出一行JSON
+// 用法：microbench [--bench all|buffer,loop] [--seconds 0.5] [--producers 4] [--out results.jsonl]
+#include "MicroBench.h"
+#include "Logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [--bench all|buffer,loop] [--seconds S] [--producers N] [--out FILE]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    MicroOptions options;
+    bool buffer = true;
+    bool loop = true;
+    for (int i = 1; i < argc; i += 2)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (::strcmp(arg, "--bench") == 0)
+        {
+            if (::strcmp(value, "all") != 0)
+            {
+                buffer = ::strstr(value, "buffer") != nullptr;
+                loop = ::strstr(value, "loop") != nullptr;
+            }
+        }
+        else if (::strcmp(arg, "--seconds") == 0) options.seconds = atof(value);
+        else if (::strcmp(arg, "--producers") == 0) options.maxProducers = atoi(value);
+        else if (::strcmp(arg, "--out") == 0) options.out = value;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Logger::setLogLevel(ERROR);
+    ResultSink sink(options.out);
+    if (buffer)
+    {
+        runBufferBenches(options, sink);
+    }
+    if (loop)
+    {
+        runLoopBenches(options, sink);
+    }
+    return 0;
+}
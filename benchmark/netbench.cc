@@ -0,0 +1,133 @@
+// 回环网络上的端到端压测，每项结果输出一行JSON
+// 用法：netbench [--bench all|pingpong,churn,latency] [--seconds 2] [--warmup 0.5] [--quick]
+//               [--loops 1,2,4] [--sizes 64,1024,16384] [--connections 64]
+//               [--latency-connections 16] [--churn-concurrency 32] [--port 9981]
+//               [--edge-triggered] [--reuseport-per-loop] [--out results.jsonl]
+#include "BenchCommon.h"
+#include "Logger.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// 逗号分隔的列表
+static std::vector<std::string> split(const char *arg)
+{
+    std::vector<std::string> items;
+    std::string text(arg);
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+        items.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+template <typename T>
+static std::vector<T> parseList(const char *arg)
+{
+    std::vector<T> values;
+    for (const std::string &item : split(arg))
+    {
+        values.push_back(static_cast<T>(atol(item.c_str())));
+    }
+    return values;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [--bench all|pingpong,churn,latency] [--seconds S] [--warmup S] [--quick]\n"
+        "          [--loops 1,2,4] [--sizes 64,1024,16384] [--connections N]\n"
+        "          [--latency-connections N] [--churn-concurrency N] [--port P]\n"
+        "          [--edge-triggered] [--reuseport-per-loop] [--out FILE]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    std::vector<std::string> benches = {"pingpong", "churn", "latency"};
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool hasValue = true;
+        if (::strcmp(arg, "--quick") == 0)
+        {
+            options.seconds = 0.5;
+            options.warmup = 0.2;
+            hasValue = false;
+        }
+        else if (::strcmp(arg, "--edge-triggered") == 0)
+        {
+            options.edgeTriggered = true;
+            hasValue = false;
+        }
+        else if (::strcmp(arg, "--reuseport-per-loop") == 0)
+        {
+            options.reusePortPerLoop = true;
+            hasValue = false;
+        }
+        else if (value == nullptr)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else if (::strcmp(arg, "--bench") == 0 && ::strcmp(value, "all") != 0) benches = split(value);
+        else if (::strcmp(arg, "--seconds") == 0) options.seconds = atof(value);
+        else if (::strcmp(arg, "--warmup") == 0) options.warmup = atof(value);
+        else if (::strcmp(arg, "--loops") == 0) options.loops = parseList<int>(value);
+        else if (::strcmp(arg, "--sizes") == 0) options.sizes = parseList<size_t>(value);
+        else if (::strcmp(arg, "--connections") == 0) options.connections = atoi(value);
+        else if (::strcmp(arg, "--latency-connections") == 0) options.latencyConnections = atoi(value);
+        else if (::strcmp(arg, "--churn-concurrency") == 0) options.churnConcurrency = atoi(value);
+        else if (::strcmp(arg, "--port") == 0) options.port = static_cast<uint16_t>(atoi(value));
+        else if (::strcmp(arg, "--out") == 0) options.out = value;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (hasValue)
+        {
+            ++i;
+        }
+    }
+    for (const std::string &bench : benches)
+    {
+        if (bench != "pingpong" && bench != "churn" && bench != "latency")
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Logger::setLogLevel(ERROR);
+    ::signal(SIGPIPE, SIG_IGN); // 对端已关闭时继续写不终止进程
+
+    ResultWriter writer(options);
+    for (const std::string &bench : benches)
+    {
+        if (bench == "pingpong")
+        {
+            runPingpong(options, writer);
+        }
+        else if (bench == "churn")
+        {
+            runChurn(options, writer);
+        }
+        else
+        {
+            runLatency(options, writer);
+        }
+    }
+    return 0;
+}
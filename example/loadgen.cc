@@ -0,0 +1,256 @@
+// 压测客户端：多个loop开N个连接，对回显服务器做pingpong或者按目标速率发消息
+// 用法：./loadgen ip port [connections=100] [threads=4] [size=4096] [rate=0] [seconds=10]
+//   rate为0：pingpong，每个连接先发一条消息，之后把收到的数据原样发回，测最大吞吐
+//   rate大于0：所有连接合计每秒发rate条消息，测给定负载下服务器的表现
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoopThreadPool.h>
+#include <mymuduo/Logger.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+class LoadGenerator;
+
+// 一个连接
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop,
+            const InetAddress &serverAddr,
+            const std::string &name,
+            LoadGenerator *owner);
+
+    void start() { client_.connect(); }
+    void stop() { client_.disconnect(); }
+    // 按速率发送时由所在loop的定时器调用，credit是这个周期应发的消息数
+    void tick(double credit);
+
+    int64_t bytesRead() const { return bytesRead_.load(std::memory_order_relaxed); }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time);
+
+    TcpClient client_;
+    LoadGenerator *owner_;
+    double credit_; // 还没发出的消息数，累积到1条以上才发
+    std::atomic<int64_t> bytesRead_; // 只有所在loop写
+};
+
+class LoadGenerator : noncopyable
+{
+public:
+    LoadGenerator(EventLoop *loop, const InetAddress &serverAddr,
+                  int connections, int threads, size_t size, double rate)
+        : loop_(loop)
+        , pool_(loop, "loadgen")
+        , size_(size)
+        , rate_(rate)
+        , message_(size, 'x')
+        , connected_(0)
+        , lastBytes_(0)
+    {
+        pool_.setThreadNum(threads);
+        pool_.start();
+        std::vector<EventLoop*> loops = pool_.getAllLoops();
+        perLoop_.resize(loops.size());
+        for (int i = 0; i < connections; ++i)
+        {
+            size_t index = i % loops.size();
+            char name[32];
+            snprintf(name, sizeof name, "C%05d", i);
+            sessions_.emplace_back(new Session(loops[index], serverAddr, name, this));
+            perLoop_[index].push_back(sessions_.back().get());
+        }
+    }
+
+    const std::string& message() const { return message_; }
+    bool pingpong() const { return rate_ <= 0; }
+
+    void start(double seconds)
+    {
+        std::vector<EventLoop*> loops = pool_.getAllLoops();
+        for (auto &session : sessions_)
+        {
+            session->start();
+        }
+        if (!pingpong())
+        {
+            // 每个loop一个定时器，按距上次触发实际经过的时间给这个loop上的连接分配发送量，定时器误差不影响总速率
+            double perSession = rate_ / sessions_.size();
+            for (size_t i = 0; i < loops.size(); ++i)
+            {
+                const std::vector<Session*> *sessions = &perLoop_[i];
+                Timestamp last = Timestamp::now();
+                tickTimers_.push_back(loops[i]->runEvery(kTickSeconds, [sessions, perSession, last]() mutable {
+                    Timestamp now = Timestamp::now();
+                    double credit = perSession * timeDifferenceMicros(now, last) / 1e6;
+                    last = now;
+                    for (Session *session : *sessions)
+                    {
+                        session->tick(credit);
+                    }
+                }));
+            }
+        }
+        startTime_ = Timestamp::now();
+        reportTimer_ = loop_->runEvery(1.0, std::bind(&LoadGenerator::report, this));
+        loop_->runAfter(seconds, std::bind(&LoadGenerator::finish, this));
+    }
+
+    void onConnected() { ++connected_; }
+    void onDisconnected() { --connected_; }
+
+private:
+    static constexpr double kTickSeconds = 0.01;
+
+    int64_t totalBytes() const
+    {
+        int64_t bytes = 0;
+        for (auto &session : sessions_)
+        {
+            bytes += session->bytesRead();
+        }
+        return bytes;
+    }
+
+    void report()
+    {
+        int64_t bytes = totalBytes();
+        printf("connected=%d MiB/s=%.2f msgs/s=%.0f\n", connected_.load(),
+            (bytes - lastBytes_) / 1048576.0, static_cast<double>(bytes - lastBytes_) / size_);
+        lastBytes_ = bytes;
+    }
+
+    void finish()
+    {
+        loop_->cancel(reportTimer_);
+        double seconds = timeDifferenceMicros(Timestamp::now(), startTime_) / 1e6;
+        int64_t bytes = totalBytes();
+        printf("mode=%s connections=%zu threads=%zu size=%zu seconds=%.2f bytes=%lld MiB/s=%.2f msgs/s=%.0f\n",
+            pingpong() ? "pingpong" : "rate", sessions_.size(), perLoop_.size(), size_, seconds,
+            static_cast<long long>(bytes), bytes / 1048576.0 / seconds, bytes / static_cast<double>(size_) / seconds);
+
+        // 在各自的loop里停掉定时器并断开连接，留一点时间让连接关闭再退出
+        std::vector<EventLoop*> loops = pool_.getAllLoops();
+        for (size_t i = 0; i < loops.size(); ++i)
+        {
+            EventLoop *ioLoop = loops[i];
+            TimerId timer = i < tickTimers_.size() ? tickTimers_[i] : TimerId();
+            const std::vector<Session*> *sessions = &perLoop_[i];
+            ioLoop->runInLoop([ioLoop, timer, sessions]() {
+                ioLoop->cancel(timer);
+                for (Session *session : *sessions)
+                {
+                    session->stop();
+                }
+            });
+        }
+        loop_->runAfter(0.5, std::bind(&EventLoop::quit, loop_));
+    }
+
+    EventLoop *loop_;
+    std::vector<std::vector<Session*>> perLoop_; // 定时器回调引用，要比loop线程活得久
+    EventLoopThreadPool pool_;
+    std::vector<std::unique_ptr<Session>> sessions_; // 先于pool_析构，析构时loop还在运行
+    std::vector<TimerId> tickTimers_;
+    TimerId reportTimer_;
+    const size_t size_;
+    const double rate_;
+    const std::string message_;
+    std::atomic_int connected_;
+    Timestamp startTime_;
+    int64_t lastBytes_;
+};
+
+constexpr double LoadGenerator::kTickSeconds;
+
+Session::Session(EventLoop *loop,
+                 const InetAddress &serverAddr,
+                 const std::string &name,
+                 LoadGenerator *owner)
+    : client_(loop, serverAddr, name)
+    , owner_(owner)
+    , credit_(0)
+    , bytesRead_(0)
+{
+    client_.setTcpNoDelay(true);
+    client_.setConnectionCallback(
+        std::bind(&Session::onConnection, this, std::placeholders::_1));
+    client_.setMessageCallback(
+        std::bind(&Session::onMessage, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void Session::tick(double credit)
+{
+    TcpConnectionPtr conn = client_.connection();
+    if (!conn || !conn->connected())
+    {
+        return;
+    }
+    credit_ += credit;
+    while (credit_ >= 1.0)
+    {
+        conn->send(owner_->message());
+        credit_ -= 1.0;
+    }
+}
+
+void Session::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        owner_->onConnected();
+        if (owner_->pingpong())
+        {
+            conn->send(owner_->message());
+        }
+    }
+    else
+    {
+        owner_->onDisconnected();
+    }
+}
+
+void Session::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time)
+{
+    bytesRead_.store(bytesRead_.load(std::memory_order_relaxed) + buf->readableBytes(),
+        std::memory_order_relaxed);
+    if (owner_->pingpong())
+    {
+        conn->send(buf->retrieveAllAsString());
+    }
+    else
+    {
+        buf->retrieveAll();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s ip port [connections] [threads] [size] [rate] [seconds]\n", argv[0]);
+        return 1;
+    }
+    Logger::setLogLevel(ERROR);
+
+    InetAddress serverAddr(static_cast<uint16_t>(atoi(argv[2])), argv[1]);
+    int connections = argc > 3 ? atoi(argv[3]) : 100;
+    int threads = argc > 4 ? atoi(argv[4]) : 4;
+    size_t size = argc > 5 ? atoi(argv[5]) : 4096;
+    double rate = argc > 6 ? atof(argv[6]) : 0;
+    double seconds = argc > 7 ? atof(argv[7]) : 10;
+
+    EventLoop loop;
+    LoadGenerator generator(&loop, serverAddr, connections, threads, size, rate);
+    generator.start(seconds);
+    loop.loop();
+    return 0;
+}